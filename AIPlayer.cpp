@@ -0,0 +1,110 @@
+#include "AIPlayer.hpp"
+#include <algorithm>
+#include <chrono>
+
+// how much each part of an outcome is worth to the player taking the shot.
+const float WIN_SCORE = 1000.0f;
+const float FOUL_SCORE = -50.0f;
+const float KEEP_TURN_SCORE = 20.0f;
+const float OWN_BALL_SCORE = 10.0f;
+const float OPPONENT_BALL_SCORE = -5.0f;
+
+// once the shot is decided there is no need to watch the balls roll out.
+StopConditions rolloutStopConditions() {
+    StopConditions stop;
+    stop.eightPocketed = true;
+    stop.scratch = true;
+    stop.illegalFirstContact = true;
+    stop.energyBelow = DEFAULT_ROLLOUT_ENERGY;
+    return stop;
+}
+
+AIPlayer::AIPlayer(int numThreads) : evaluator(numThreads) {
+    evaluator.stopConditions = rolloutStopConditions();
+    evaluator.cache = &cache;
+}
+
+AIPlayer::~AIPlayer() {
+    // don't keep the game from closing while a search is still running.
+    cancelled = true;
+    if (search.valid())
+        search.wait();
+}
+
+void AIPlayer::startSearch(const GameLogic& game) {
+    // a search still running is told to stop and waited for first: it would share random with the new one.
+    if (search.valid()) {
+        cancelled = true;
+        search.wait();
+    }
+    cancelled = false;
+    search = std::async(std::launch::async, &AIPlayer::findShot, this, game);
+}
+
+bool AIPlayer::poll(Shot& shot) {
+    if (!search.valid() || search.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return false;
+    shot = search.get();
+    return true;
+}
+
+Shot AIPlayer::findShot(GameLogic table) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<float>(timeBudget);
+    table.trackRotation = false;
+    int player = table.getCurrentPlayer();
+    Ball::BallType target = table.getTargetType();
+    
+    std::uniform_real_distribution<float> anyDirection(0.0f, 360.0f);
+    std::uniform_real_distribution<float> anyCharge(AI_MIN_CHARGE, AI_MAX_CHARGE);
+    std::normal_distribution<float> nudge(0.0f, 1.0f);
+    
+    // the best shots so far, best first.
+    std::vector<std::pair<float, Shot>> best;
+    std::vector<Shot> candidates(AI_BATCH_SIZE);
+    do {
+        // half of every batch explores, the other half refines the best shots found so far.
+        for (int i = 0; i < AI_BATCH_SIZE; i++) {
+            if (best.size() < AI_KEEP_BEST || i % 2 == 0) {
+                candidates[i] = {anyDirection(random), anyCharge(random)};
+            } else {
+                Shot around = best[random() % best.size()].second;
+                candidates[i] = {around.direction + nudge(random) * AI_DIRECTION_SPREAD,
+                                 std::clamp(around.charge * (1 + nudge(random) * AI_CHARGE_SPREAD), AI_MIN_CHARGE, AI_MAX_CHARGE)};
+            }
+        }
+        
+        std::vector<ShotOutcome> outcomes = evaluator.evaluate(table, candidates);
+        for (auto& outcome : outcomes)
+            best.push_back({scoreOutcome(outcome, player, target), outcome.shot});
+        std::stable_sort(best.begin(), best.end(), [](auto& a, auto& b) {return a.first > b.first;});
+        if (best.size() > AI_KEEP_BEST)
+            best.resize(AI_KEEP_BEST);
+    } while (std::chrono::steady_clock::now() < deadline && !cancelled);
+    
+    return best.front().second;
+}
+
+// judged with the same rules as GameLogic: what the player was supposed to hit,
+// fouls, whether they keep the turn, and the win or loss that comes with the 8.
+float scoreOutcome(const ShotOutcome& outcome, int player, Ball::BallType target) {
+    if (outcome.winner != -1)
+        return outcome.winner == player ? WIN_SCORE : -WIN_SCORE;
+    
+    float score = 0;
+    if (outcome.foul)
+        score += FOUL_SCORE;
+    if (outcome.nextPlayer == player)
+        score += KEEP_TURN_SCORE;
+    for (int id : outcome.pocketed) {
+        Ball ball;
+        ball.id = id;
+        if (ball.getType() == Ball::CUE || ball.getType() == Ball::EIGHT)
+            continue;
+        // before the colors are chosen any ball will do.
+        if (target == Ball::CUE || ball.getType() == target)
+            score += OWN_BALL_SCORE;
+        else
+            score += OPPONENT_BALL_SCORE;
+    }
+    return score;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GameLogic.hpp"
+#include "ShotCache.hpp"
+#include "ShotEvaluator.hpp"
+#include <atomic>
+#include <future>
+#include <random>
+
+const float DEFAULT_AI_TIME_BUDGET = 1.5f; // seconds of thinking per shot.
+const float AI_MIN_CHARGE = 0.2f;
+const float AI_MAX_CHARGE = 3.0f;
+const int AI_BATCH_SIZE = 64;  // shots simulated between two looks at the clock.
+const int AI_KEEP_BEST = 8;    // the shots later batches try small variations of.
+const float AI_DIRECTION_SPREAD = 2.0f; // in degrees.
+const float AI_CHARGE_SPREAD = 0.05f;   // relative.
+const size_t AI_CACHE_CAPACITY = 1 << 14;
+
+// Computer opponent: samples shots, plays each of them out with the physics on every core,
+// and picks the one that does best by the rules of the game.
+// The search runs in the background, so the render loop only ever polls for the result.
+class AIPlayer {
+public:
+    // 0 uses one thread per hardware thread.
+    explicit AIPlayer(int numThreads = 0);
+    ~AIPlayer();
+    
+    float timeBudget = DEFAULT_AI_TIME_BUDGET;
+    
+    // starts looking for a shot for the player whose turn it is. The game is copied, not kept.
+    // A search already running is abandoned, after waiting for it to notice.
+    void startSearch(const GameLogic& game);
+    bool isSearching() {return search.valid();}
+    // true once the search is over, with the shot it settled on.
+    bool poll(Shot& shot);
+    // outcomes are kept across searches, a position that comes up again is not simulated twice.
+    ShotCache& getCache() {return cache;}
+    
+private:
+    ShotCache cache{AI_CACHE_CAPACITY};
+    ShotEvaluator evaluator;
+    std::future<Shot> search;
+    std::atomic<bool> cancelled{false};
+    std::mt19937 random{std::random_device()()};
+    
+    Shot findShot(GameLogic table);
+};
+
+// the conditions under which a search stops watching a shot, once the outcome is decided.
+StopConditions rolloutStopConditions();
+// how good an outcome is for the player who took the shot, who was supposed to pocket target.
+float scoreOutcome(const ShotOutcome& outcome, int player, Ball::BallType target);
@@ -0,0 +1,98 @@
+#include "AimPreview.hpp"
+#include <cmath>
+
+void AimPreview::update(const GameLogic& game, float direction, float charge) {
+    uint64_t now = game.checksum();
+    if (now != table) {
+        cache.clear();
+        table = now;
+        pending = false;
+        hasShown = false;
+    }
+    
+    int32_t directionStep = (int32_t)std::lround(direction / AIM_PREVIEW_DIRECTION_STEP);
+    int32_t chargeStep = (int32_t)std::lround(charge / AIM_PREVIEW_CHARGE_STEP);
+    uint64_t key = (uint64_t(uint32_t(directionStep)) << 32) | uint32_t(chargeStep);
+    auto cached = cache.find(key);
+    if (cached != cache.end()) {
+        shown = cached->second;
+        hasShown = true;
+        pending = false;
+        return;
+    }
+    
+    // the prediction under way is finished even if the aim moved on meanwhile: dropping it would leave
+    // nothing new to show for as long as the aim keeps turning. The next frame starts on the current aim.
+    if (!pending) {
+        rollout = game;
+        rollout.solver = GameLogic::EVENT_DRIVEN;
+        rollout.recordEvents = true;
+        rollout.trackRotation = false;
+        rollout.strike(directionStep * AIM_PREVIEW_DIRECTION_STEP, chargeStep * AIM_PREVIEW_CHARGE_STEP);
+        pendingKey = key;
+        pending = true;
+        ticks = 0;
+        seenEvents = 0;
+        touched = false;
+        working = AimPrediction();
+    }
+    
+    // looked at after every tick, so a frame overruns its budget by one tick at most.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<float>(AIM_PREVIEW_FRAME_BUDGET);
+    StopConditions stop;
+    bool done = false;
+    bool outOfTime = false;
+    stop.custom = [this, &done, &outOfTime, deadline](GameLogic& game) {
+        done = checkProgress(game);
+        outOfTime = !done && std::chrono::steady_clock::now() >= deadline;
+        return done || outOfTime;
+    };
+    int simulated = rollout.simulateShot(stop, AIM_PREVIEW_MAX_TICKS - ticks);
+    ticks += simulated;
+    // stopped by anything but the clock: the prediction is complete, the balls came to rest, or it looked far enough.
+    if (!outOfTime)
+        finish();
+}
+
+// looks at the tick just simulated, true once the prediction is complete.
+bool AimPreview::checkProgress(GameLogic& game) {
+    auto& events = game.getEvents();
+    for (; seenEvents < events.size(); seenEvents++) {
+        const GameEvent& event = events[seenEvents];
+        if (!touched && event.type == GameEvent::BALL_BALL && (event.ball == 0 || event.other == 0)) {
+            touched = true;
+            working.cueBall = game.getBall(0).position;
+            working.objectBall = event.ball == 0 ? event.other : event.ball;
+        }
+        // a scratch before any contact ends the cue ball's path.
+        if (!touched && event.type == GameEvent::POCKET && event.ball == 0)
+            return true;
+    }
+    // followed tick by tick, as a foul puts the cue ball back on the spot once the shot is over.
+    if (!touched) {
+        int hole = game.getHoleIndex(0);
+        working.cueBall = hole != -1 ? game.getHolePosition(hole) : game.getBall(0).position;
+        return false;
+    }
+    Ball object = game.getBall(working.objectBall);
+    return object.inHole != -1 || object.velocity == glm::vec2(0);
+}
+
+void AimPreview::finish() {
+    if (working.objectBall != -1) {
+        int hole = rollout.getHoleIndex(working.objectBall);
+        working.objectEnd = hole != -1 ? rollout.getHolePosition(hole) : rollout.getBall(working.objectBall).position;
+    }
+    if (cache.size() >= AIM_PREVIEW_CACHE_CAPACITY)
+        cache.clear();
+    cache[pendingKey] = working;
+    shown = working;
+    hasShown = true;
+    pending = false;
+}
+
+bool AimPreview::get(AimPrediction& prediction) {
+    if (hasShown)
+        prediction = shown;
+    return hasShown;
+}
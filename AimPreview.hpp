@@ -0,0 +1,53 @@
+#pragma once
+
+#include "GameLogic.hpp"
+#include <chrono>
+#include <unordered_map>
+
+const float AIM_PREVIEW_DIRECTION_STEP = 0.25f; // in degrees, previews are worked out for directions this far apart.
+const float AIM_PREVIEW_CHARGE_STEP = 0.05f;    // in seconds of charge.
+const float AIM_PREVIEW_DEFAULT_CHARGE = 1.0f;  // shown until fire is held.
+const float AIM_PREVIEW_FRAME_BUDGET = 0.002f;  // seconds of a frame the preview may spend simulating.
+const int AIM_PREVIEW_MAX_TICKS = DEFAULT_PHYSICS_TICK_RATE * 4; // a prediction looks no further ahead.
+const size_t AIM_PREVIEW_CACHE_CAPACITY = 4096;
+
+// Where the shot being aimed would take the cue ball and the first ball it hits.
+struct AimPrediction
+{
+    glm::vec2 cueBall;   // where it first touches another ball, or where it stops or falls in if it touches none.
+    int objectBall = -1; // the first ball it touches, -1 for none.
+    glm::vec2 objectEnd; // where that ball stops or falls in.
+};
+
+// Works out an AimPrediction for the direction and charge being aimed, a slice at a time so that the frame
+// never spends much more than AIM_PREVIEW_FRAME_BUDGET on it. The budget is measured on the clock rather than
+// counted in ticks, since what a tick costs grows with the events in it and the balls on the table.
+// Until the prediction for the current aim is done, the last finished one is shown, at most a few frames behind.
+// Finished predictions are kept per quantized direction and charge, so sweeping the aim back and forth only simulates each direction once.
+// The preview runs the event-driven solver, whose ticks are nearly free between two collisions,
+// whichever solver the game itself uses.
+class AimPreview {
+public:
+    // to be called every frame while aiming. Forgets every prediction once the table changes.
+    void update(const GameLogic& game, float direction, float charge);
+    // the prediction to draw, false if there is none yet.
+    bool get(AimPrediction& prediction);
+
+private:
+    std::unordered_map<uint64_t, AimPrediction> cache;
+    uint64_t table = 0;
+    AimPrediction shown;
+    bool hasShown = false;
+
+    // the prediction being worked out.
+    GameLogic rollout;
+    uint64_t pendingKey = 0;
+    bool pending = false;
+    int ticks = 0;
+    size_t seenEvents = 0;
+    bool touched = false;
+    AimPrediction working;
+
+    bool checkProgress(GameLogic& game);
+    void finish();
+};
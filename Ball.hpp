@@ -0,0 +1,51 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+const float BALL_HEIGHT = 0.5f;
+const float BALL_SCALE = 0.4;
+
+struct Hole
+{
+    glm::vec2 position;
+    float radius = 1.5;
+};
+
+// position, velocity and radius live in BallPhysics while simulating,
+// they are only filled in on the copies handed out by GameLogic::getBall.
+struct Ball
+{
+    int id = -1;
+    glm::vec2 position;
+    glm::quat rotation = glm::quat(1, 0, 0, 0);
+    glm::vec2 velocity = glm::vec2(0);
+    float radius = 1; // in logical units.
+    int inHole = -1; // index into GameLogic's holes, -1 while on the table.
+    bool animatingFall = false;
+    bool hide = false;
+    
+    enum BallType {CUE, EIGHT, FULL, STRIPE};
+
+    BallType getType() {
+        if(id == 0) return CUE;
+        if(id < 8) return FULL;
+        if(id == 8) return EIGHT;
+        return STRIPE;
+    }
+    
+    glm::mat4 computeWorldMatrix() {
+        if(hide)
+            return glm::scale(glm::mat4(1), glm::vec3(0));
+        
+        return computeTranslationMatrix() * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1), glm::vec3(BALL_SCALE * radius));
+    }
+    
+    glm::mat4 computeTranslationMatrix() {
+        return glm::translate(glm::mat4(1), glm::vec3(position.x / 2, BALL_HEIGHT, -position.y / 2));
+    }
+};
@@ -0,0 +1,292 @@
+// Measures the cost of the simulation, for comparing builds against each other.
+//
+//     benchmark [--reps N] [--warmup N] [--balls N] [--event-driven] [--grid] [--tick-rate HZ]
+//               [--rollout] [--only NAME] [--json FILE]
+//
+// Whole shots (break, midgame, cluster) are played to rest and timed per physics step.
+// With --rollout they stop as early as the AI's rollouts do instead.
+// The kernels are timed per call, in batches of KERNEL_BATCH calls starting from a mid-game position.
+// --json writes every result to FILE as well, with the configuration it was measured in.
+
+#include "GameLogic.hpp"
+#include "json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+const float BREAK_CHARGE = 4.0f;
+const float CLUSTER_SPEED = 4.0f;
+const int KERNEL_BATCH = 1000;
+const int MIDGAME_BALLS_LEFT = 9;
+
+struct Options {
+    int reps = 50;
+    int warmup = 5;
+    int numBalls = NUM_BALLS;
+    bool eventDriven = false;
+    bool grid = false;
+    int tickRate = DEFAULT_PHYSICS_TICK_RATE;
+    bool rollout = false;
+    std::string only;
+    std::string json;
+};
+
+// One rep of a benchmark: how long it took and how many steps or calls it made.
+struct Sample {
+    double nanoseconds;
+    long long steps;
+};
+
+struct Result {
+    std::string name;
+    std::string unit;
+    std::vector<double> perStep; // sorted
+    double stepsPerRep;
+    double repsPerSecond;
+};
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, (size_t)(p / 100 * sorted.size()))];
+}
+
+// Reaches into GameLogic to set up positions and call the kernels directly.
+struct PhysicsBenchmark {
+    Options options;
+
+    void setUp(GameLogic& game) {
+        game.init(options.numBalls);
+        game.solver = options.eventDriven ? GameLogic::EVENT_DRIVEN : GameLogic::STEPPED;
+        game.broadPhase = options.grid ? GameLogic::UNIFORM_GRID : GameLogic::BRUTE_FORCE;
+        game.physicsTickRate = options.tickRate;
+        game.trackRotation = false;
+    }
+
+    // the rack and a hard straight shot into it.
+    void setUpBreak(GameLogic& game, int) {
+        setUp(game);
+        game.strike(90.0f, BREAK_CHARGE);
+    }
+
+    // some balls already pocketed, the rest scattered over the table and all of them moving.
+    void setUpMidgame(GameLogic& game, int seed) {
+        setUp(game);
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> x(TABLE_BOTTOM_EDGE + 1, TABLE_TOP_EDGE - 1);
+        std::uniform_real_distribution<float> y(TABLE_LEFT_EDGE + 1, TABLE_RIGHT_EDGE - 1);
+        int left = std::max(1, game.numBalls * MIDGAME_BALLS_LEFT / NUM_BALLS);
+        for (int i = 0; i < left; i++) {
+            // keep trying until it does not overlap the balls placed so far.
+            for (int attempt = 0; attempt < 100; attempt++) {
+                game.setPosition(i, glm::vec2(x(random), y(random)));
+                bool free = true;
+                for (int j = 0; j < i; j++)
+                    free = free && glm::distance(game.positionOf(i), game.positionOf(j)) >= game.physics.radius[i] + game.physics.radius[j];
+                if (free)
+                    break;
+            }
+        }
+        srand(seed);
+        game.setRandomBallVelocities();
+        for (int i = left; i < game.numBalls; i++) {
+            game.balls[i].inHole = 0;
+            game.balls[i].hide = true;
+            game.physics.active[i] = 0;
+            game.setVelocity(i, glm::vec2(0));
+            game.awake.sleep(i);
+        }
+        game.strike(random() % 360, 1.0f + random() % 3);
+    }
+
+    // every ball packed in one hexagonal cluster in the middle of the table, jostling.
+    void setUpCluster(GameLogic& game, int seed) {
+        setUp(game);
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> speed(-CLUSTER_SPEED, CLUSTER_SPEED);
+        float pitch = 2 * game.physics.radius[0];
+        int perRow = std::max(1, (int)std::ceil(std::sqrt((float)game.numBalls)));
+        for (int i = 0; i < game.numBalls; i++) {
+            int row = i / perRow;
+            int column = i % perRow;
+            game.setPosition(i, glm::vec2((column - perRow / 2 + (row % 2) * 0.5f) * pitch,
+                                          (row - perRow / 2) * pitch * std::sqrt(3.0f) / 2));
+            game.setVelocity(i, glm::vec2(speed(random), speed(random)));
+        }
+        game.aiming = false;
+        game.eventsDirty = true;
+    }
+
+    Sample playShot(void (PhysicsBenchmark::*setUpShot)(GameLogic&, int), int seed) {
+        StopConditions stop;
+        if (options.rollout) {
+            stop.eightPocketed = true;
+            stop.scratch = true;
+            stop.illegalFirstContact = true;
+            stop.energyBelow = DEFAULT_ROLLOUT_ENERGY;
+        }
+        GameLogic game;
+        (this->*setUpShot)(game, seed);
+        auto start = std::chrono::steady_clock::now();
+        int steps = game.simulateShot(stop);
+        return {std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count(), steps};
+    }
+
+    // a mid-game position a little into the shot, when every ball is still rolling.
+    GameLogic kernelPosition(int seed) {
+        GameLogic game;
+        setUpMidgame(game, seed);
+        for (int i = 0; i < options.tickRate / 10; i++)
+            game.stepPhysics(1.0f / options.tickRate);
+        return game;
+    }
+
+    Sample runKernel(const std::function<void(GameLogic&)>& kernel, int seed) {
+        GameLogic game = kernelPosition(seed);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < KERNEL_BATCH; i++)
+            kernel(game);
+        return {std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count(), KERNEL_BATCH};
+    }
+
+    Result measure(const std::string& name, const std::string& unit, const std::function<Sample(int)>& rep) {
+        for (int i = 0; i < options.warmup; i++)
+            rep(-1 - i);
+
+        Result result = {name, unit, {}, 0, 0};
+        double totalNanoseconds = 0;
+        long long totalSteps = 0;
+        for (int i = 0; i < options.reps; i++) {
+            Sample sample = rep(i);
+            result.perStep.push_back(sample.nanoseconds / std::max(1ll, sample.steps));
+            totalNanoseconds += sample.nanoseconds;
+            totalSteps += sample.steps;
+        }
+        std::sort(result.perStep.begin(), result.perStep.end());
+        result.stepsPerRep = (double)totalSteps / options.reps;
+        result.repsPerSecond = options.reps * 1e9 / totalNanoseconds;
+        return result;
+    }
+
+    std::vector<Result> run() {
+        float tick = 1.0f / options.tickRate;
+        std::vector<Result> results;
+        auto wanted = [&](const std::string& name) {return options.only.empty() || options.only == name;};
+
+        if (wanted("break"))
+            results.push_back(measure("break", "ns/step", [&](int seed) {return playShot(&PhysicsBenchmark::setUpBreak, seed);}));
+        if (wanted("midgame"))
+            results.push_back(measure("midgame", "ns/step", [&](int seed) {return playShot(&PhysicsBenchmark::setUpMidgame, seed);}));
+        if (wanted("cluster"))
+            results.push_back(measure("cluster", "ns/step", [&](int seed) {return playShot(&PhysicsBenchmark::setUpCluster, seed);}));
+
+        if (wanted("checkCollisions"))
+            results.push_back(measure("checkCollisions", "ns/call", [&](int seed) {
+                return runKernel([](GameLogic& game) {game.checkCollisions();}, seed);
+            }));
+        if (wanted("computeFrame"))
+            results.push_back(measure("computeFrame", "ns/call", [&](int seed) {
+                return runKernel([tick](GameLogic& game) {game.computeFrame(tick);}, seed);
+            }));
+        if (wanted("checkWhetherAnyBallsGoIn"))
+            results.push_back(measure("checkWhetherAnyBallsGoIn", "ns/call", [&](int seed) {
+                return runKernel([](GameLogic& game) {game.checkWhetherAnyBallsGoIn();}, seed);
+            }));
+        return results;
+    }
+};
+
+static void usage() {
+    std::cerr << "usage: benchmark [--reps N] [--warmup N] [--balls N] [--event-driven] [--grid] [--tick-rate HZ]\n"
+                 "                 [--rollout] [--only NAME] [--json FILE]\n"
+                 "--balls N is at most " << MAX_BALLS << ", rebuild with -DBILLIARDS_MAX_BALLS=N for larger tables\n";
+    exit(1);
+}
+
+static Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--reps") == 0 && hasValue)
+            options.reps = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+            options.warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--balls") == 0 && hasValue)
+            options.numBalls = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--event-driven") == 0)
+            options.eventDriven = true;
+        else if (strcmp(argv[i], "--grid") == 0)
+            options.grid = true;
+        else if (strcmp(argv[i], "--tick-rate") == 0 && hasValue)
+            options.tickRate = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rollout") == 0)
+            options.rollout = true;
+        else if (strcmp(argv[i], "--only") == 0 && hasValue)
+            options.only = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && hasValue)
+            options.json = argv[++i];
+        else
+            usage();
+    }
+    return options;
+}
+
+static void writeJson(const Options& options, const std::vector<Result>& results) {
+    nlohmann::json json;
+    json["config"] = {
+        {"reps", options.reps},
+        {"warmup", options.warmup},
+        {"balls", std::min(options.numBalls, MAX_BALLS)},
+        {"maxBalls", MAX_BALLS},
+        {"simdWidth", SIMD_WIDTH},
+        {"solver", options.eventDriven ? "event-driven" : "stepped"},
+        {"broadPhase", options.grid ? "grid" : "brute-force"},
+        {"tickRate", options.tickRate},
+        {"rollout", options.rollout},
+    };
+    json["results"] = nlohmann::json::array();
+    for (auto& result : results) {
+        json["results"].push_back({
+            {"name", result.name},
+            {"unit", result.unit},
+            {"min", result.perStep.front()},
+            {"p50", percentile(result.perStep, 50)},
+            {"p90", percentile(result.perStep, 90)},
+            {"p99", percentile(result.perStep, 99)},
+            {"max", result.perStep.back()},
+            {"stepsPerRep", result.stepsPerRep},
+            {"repsPerSecond", result.repsPerSecond},
+        });
+    }
+    std::ofstream file(options.json);
+    file << json.dump(2) << "\n";
+}
+
+int main(int argc, char** argv) {
+    PhysicsBenchmark benchmark;
+    benchmark.options = parseOptions(argc, argv);
+    std::vector<Result> results = benchmark.run();
+
+    std::cout << std::left << std::setw(36) << "benchmark" << std::right
+              << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99"
+              << std::setw(12) << "steps/shot" << std::setw(12) << "shots/s" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    for (auto& result : results) {
+        std::cout << std::left << std::setw(36) << result.name + " (" + result.unit + ")" << std::right
+                  << std::setw(10) << percentile(result.perStep, 50)
+                  << std::setw(10) << percentile(result.perStep, 90)
+                  << std::setw(10) << percentile(result.perStep, 99);
+        // kernels are not shots.
+        if (result.unit == "ns/step")
+            std::cout << std::setw(12) << result.stepsPerRep << std::setw(12) << result.repsPerSecond;
+        std::cout << "\n";
+    }
+
+    if (!benchmark.options.json.empty())
+        writeJson(benchmark.options, results);
+    return 0;
+}
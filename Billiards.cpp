@@ -3,6 +3,14 @@
 #include "Starter.hpp"
 #include "Camera.hpp"
 #include "GameLogic.hpp"
+#include "AIPlayer.hpp"
+#include "Replay.hpp"
+#include "InputCapture.hpp"
+#include "ShotTimeline.hpp"
+#include "AimPreview.hpp"
+#include "Telemetry.hpp"
+
+const char* const LAST_REPLAY_PATH = "last.replay";
 
 // The uniform buffer objects data structures
 // Remember to use the correct alignas(...) value
@@ -75,12 +83,12 @@ protected:
     Model<Vertex> MTable, MStick, MPointer;
     Model<VertexOverlay> MP1Turn, MP2Turn, MP1Win, MP2Win, MP1HitsStripes, MP1HitsSolids;
     // Descriptor sets
-    DescriptorSet DSTable, DSStick, DSPointer, DSP1Turn, DSP2Turn, DSP1Win, DSP2Win, DSP1HitsStripes, DSP1HitsSolids, DSLighting;
+    DescriptorSet DSTable, DSStick, DSPointer, DSPointerTarget, DSP1Turn, DSP2Turn, DSP1Win, DSP2Win, DSP1HitsStripes, DSP1HitsSolids, DSLighting;
     // Textures
     Texture TPointer, TFurniture, TP1Turn, TP2Turn, TP1Win, TP2Win, TP1HitsStripes, TP1HitsSolids, TStick;
     
     // C++ storage for uniform variables
-    UniformBlock uboTable, uboStick, uboPointer;
+    UniformBlock uboTable, uboStick, uboPointer, uboPointerTarget;
     OverlayUniformBlock uboP1Turn, uboP2Turn, uboP1Win, uboP2Win, uboP1HitsSolids, uboP1HitsStripes;
     SpotlightUniformBufferObject uboLighting;
     
@@ -88,6 +96,30 @@ protected:
     BallObject balls[NUM_BALLS];
     Camera camera;
     GameLogic gameLogic;
+    AIPlayer ai;
+    // the second player is a human unless --ai is given.
+    bool player2IsAI = false;
+    // every game is recorded, and written to LAST_REPLAY_PATH on the way out.
+    ReplayWriter recording;
+    // while playing a replay back, fire plays the next shot and page up/down seek a shot back or forward.
+    ReplayReader playback;
+    bool playingBack = false;
+    int playbackShot = 0; // the next one to be played.
+    bool fireWasPressed = false, seekWasPressed = false;
+    // while aiming, ghost balls show where the cue ball meets the first ball it hits, and where that one goes.
+    AimPreview aimPreview;
+    // a shot is simulated whole when it is struck, and drawn from its timeline until shotTime reaches its end.
+    ShotTimeline timeline;
+    bool shotPlaying = false;
+    float shotTime = 0;
+    // a session captured frame by frame, or played back from one in place of the devices and the clock.
+    InputCapture inputCapture;
+    // what happens on the table, streamed to telemetryPath when it is set.
+    std::unique_ptr<Telemetry> telemetry;
+public:
+    std::string replayPath; // played back instead of a new game when set.
+    std::string recordInputPath, playInputPath, frameTimesPath, telemetryPath; // see main().
+protected:
     // Here you set the main application parameters
     void setWindowParameters() {
         // window size, titile and initial background
@@ -98,9 +130,9 @@ protected:
         initialBackgroundColor = {0.0f, 0.005f, 0.01f, 1.0f};
         
         // Descriptor pool sizes
-        uniformBlocksInPool = 10 + NUM_BALLS;
+        uniformBlocksInPool = 11 + NUM_BALLS;
         texturesInPool = 11 + NUM_BALLS + NUM_BALLS;
-        setsInPool = 10 + NUM_BALLS;
+        setsInPool = 11 + NUM_BALLS;
         
         camera.aspectRatio = (float)windowWidth / (float)windowHeight;
     }
@@ -194,7 +226,7 @@ protected:
         
         MTable.init(this, &VD, "models/pool_table.obj", OBJ);
         for (auto &ball : balls) {
-            ball.model.init(this, &VD, "Models/ball.obj", OBJ);
+            ball.model.init(this, &VD, "models/ball.obj", OBJ);
         }
         MStick.init(this, &VD, "models/stick.obj", OBJ);
         MPointer.init(this, &VD, "models/ball.obj", OBJ);
@@ -236,26 +268,47 @@ protected:
 
         
         // Create the textures
-        // The second parameter is the file name
-        TPointer.init(this,   "textures/ball_8.png");
-        TFurniture.init(this, "textures/pool_table.png");
-        TStick.init(this, "textures/BilliardStick_DefaultMaterial_AlbedoTransparency.png");
+        // The second parameter is the file name. They are decoded in parallel and uploaded together by load().
+        TextureBatch textures;
+        textures.add(TPointer,   "textures/ball_0.png");
+        textures.add(TFurniture, "textures/pool_table.png");
+        textures.add(TStick, "textures/BilliardStick_DefaultMaterial_AlbedoTransparency.png");
         int id = 0;
         for (auto &ball : balls) {
             std::string path = "textures/ball_" + std::to_string(id++) + ".png";
-            ball.tex.init(this, path.data());
+            textures.add(ball.tex, path.data());
         }
-        TP1Turn.init(this,"textures/P1_turn.png");
-        TP2Turn.init(this,"textures/P2_turn.png");
-        TP1Win.init(this, "textures/Player_1_win.png");
-        TP2Win.init(this, "textures/Player_2_win.png");
-        TP1HitsSolids.init(this, "textures/P1_hits_solids.png");
-        TP1HitsStripes.init(this, "textures/P1_hits_stripes.png");
+        textures.add(TP1Turn,"textures/P1_turn.png");
+        textures.add(TP2Turn,"textures/P2_turn.png");
+        textures.add(TP1Win, "textures/Player_1_win.png");
+        textures.add(TP2Win, "textures/Player_2_win.png");
+        textures.add(TP1HitsSolids, "textures/P1_hits_solids.png");
+        textures.add(TP1HitsStripes, "textures/P1_hits_stripes.png");
+        textures.load(this);
 
         
         // Init local variables
         initCamera(camera);
         gameLogic.init();
+        // so that the recorded shots play out the same again.
+        gameLogic.deterministic = true;
+        recording.start(gameLogic);
+        if(!replayPath.empty()) {
+            playingBack = playback.open(replayPath) && playback.seek(gameLogic, 0);
+            if(!playingBack)
+                std::cerr << "could not play back " << replayPath << std::endl;
+        }
+        if(!telemetryPath.empty()) {
+            telemetry = std::make_unique<Telemetry>(telemetryPath);
+            if(telemetry->isOpen())
+                gameLogic.setTelemetry(telemetry.get());
+            else
+                std::cerr << "could not write the telemetry to " << telemetryPath << std::endl;
+        }
+        if(!recordInputPath.empty() && !inputCapture.startRecording(recordInputPath))
+            std::cerr << "could not record the input to " << recordInputPath << std::endl;
+        if(!playInputPath.empty() && !inputCapture.startPlayback(playInputPath))
+            std::cerr << "could not play back the input of " << playInputPath << std::endl;
     }
     
 	// Here you create your pipelines and Descriptor Sets!
@@ -278,6 +331,10 @@ protected:
             {0, UNIFORM, sizeof(UniformBlock), nullptr},
             {1, TEXTURE, 0, &TPointer}
         });
+        DSPointerTarget.init(this, &DSL, {
+            {0, UNIFORM, sizeof(UniformBlock), nullptr},
+            {1, TEXTURE, 0, &TPointer}
+        });
         DSP1Turn.init(this, &DSL, {
             {0, UNIFORM, sizeof(OverlayUniformBlock), nullptr},
             {1, TEXTURE, 0, &TP1Turn}
@@ -327,6 +384,7 @@ protected:
         DSTable.cleanup();
         DSStick.cleanup();
         DSPointer.cleanup();
+        DSPointerTarget.cleanup();
         DSP1Turn.cleanup();
         DSP2Turn.cleanup();
         DSP1Win.cleanup();
@@ -345,6 +403,20 @@ protected:
 	// You also have to destroy the pipelines: since they need to be rebuilt, they have two different
 	// methods: .cleanup() recreates them, while .destroy() delete them completely
 	void localCleanup() {
+        if(!playingBack && recording.getNumShots() > 0)
+            recording.write(LAST_REPLAY_PATH);
+        if(inputCapture.getMode() == InputCapture::PLAYING_BACK) {
+            inputCapture.printFrameTimes(std::cout);
+            if(!frameTimesPath.empty())
+                inputCapture.writeFrameTimes(frameTimesPath);
+        }
+        if(telemetry) {
+            gameLogic.setTelemetry(nullptr);
+            if(telemetry->getDropped() > 0)
+                std::cerr << telemetry->getDropped() << " telemetry events dropped" << std::endl;
+            telemetry.reset();
+        }
+        
 		// Cleanup textures
 		TPointer.cleanup();
         TFurniture.cleanup();
@@ -410,6 +482,9 @@ protected:
         MPointer.bind(commandBuffer);
         vkCmdDrawIndexed(commandBuffer,static_cast<uint32_t>(MPointer.indices.size()), 1, 0, 0, 0);
         
+        DSPointerTarget.bind(commandBuffer, PBlinn, 1, currentImage);
+        vkCmdDrawIndexed(commandBuffer,static_cast<uint32_t>(MPointer.indices.size()), 1, 0, 0, 0);
+        
         for(auto &ball : balls) {
             ball.descriptorSet.bind(commandBuffer, PBlinn, 1, currentImage);
             ball.model.bind(commandBuffer);
@@ -443,6 +518,50 @@ protected:
         
 	}
 
+    // the AI thinks against the wall clock, so a captured session strikes the shots it struck then instead.
+    bool pollAI(CapturedFrame& frame, Shot& shot) {
+        if(inputCapture.getMode() == InputCapture::PLAYING_BACK) {
+            shot = frame.aiShot;
+            return frame.aiStruck;
+        }
+        if(ai.poll(shot)) {
+            frame.aiStruck = true;
+            frame.aiShot = shot;
+            return true;
+        }
+        if(!ai.isSearching())
+            ai.startSearch(gameLogic);
+        return false;
+    }
+    
+    // takes the stick away from the players and hands it to the replay.
+    void updatePlayback(Input& input) {
+        bool fire = input.fire;
+        input.fire = false;
+        input.r = glm::vec3(0);
+        
+        bool back = glfwGetKey(window, GLFW_KEY_PAGE_UP);
+        bool forward = glfwGetKey(window, GLFW_KEY_PAGE_DOWN);
+        if((back || forward) && !seekWasPressed) {
+            int shot = std::clamp(playbackShot + (forward ? 1 : -1), 0, playback.getNumShots());
+            if(playback.seek(gameLogic, shot)) {
+                playbackShot = shot;
+                shotPlaying = false;
+            }
+        }
+        seekWasPressed = back || forward;
+        
+        if(gameLogic.aiming && playbackShot < playback.getNumShots()) {
+            Shot shot = playback.getShot(playbackShot);
+            gameLogic.direction = shot.direction;
+            if(fire && !fireWasPressed) {
+                gameLogic.strike(shot.direction, shot.charge);
+                playbackShot++;
+            }
+        }
+        fireWasPressed = fire;
+    }
+    
 	// Here is where you update the uniforms.
 	// Very likely this will be where you will be writing the logic of your application.
 	void updateUniformBuffer(uint32_t currentImage) {
@@ -451,11 +570,57 @@ protected:
 			glfwSetWindowShouldClose(window, GL_TRUE);
 		}
         
-        Input input;
-        getSixAxis(input.deltaT, input.m, input.r, input.fire);
+        CapturedFrame frame;
+        if(inputCapture.getMode() == InputCapture::PLAYING_BACK) {
+            // the session is over once the captured frames are.
+            if(!inputCapture.nextFrame(frame))
+                glfwSetWindowShouldClose(window, GL_TRUE);
+        } else {
+            getSixAxis(frame.input.deltaT, frame.input.m, frame.input.r, frame.input.fire);
+        }
+        Input input = frame.input;
         
         updateCamera(camera, input);
-        gameLogic.updateGame(input);
+        // the position a shot is played from, and how long fire was held for it, for the recording.
+        bool wasAiming = gameLogic.aiming && gameLogic.getWinner() == -1;
+        GameState beforeShot;
+        if(wasAiming)
+            gameLogic.save(beforeShot);
+        float charge = wasAiming ? beforeShot.chargeTime : 0.0f;
+        if(playingBack) {
+            updatePlayback(input);
+        } else if(player2IsAI && gameLogic.aiming && gameLogic.getCurrentPlayer() == 1 && gameLogic.getWinner() == -1) {
+            // the stick belongs to the AI, which thinks in the background while the aiming view is shown.
+            input.fire = false;
+            input.r = glm::vec3(0);
+            Shot shot;
+            if(pollAI(frame, shot)) {
+                charge = shot.charge;
+                gameLogic.strike(shot.direction, shot.charge);
+            }
+        }
+        inputCapture.recordFrame(frame);
+        if(shotPlaying) {
+            shotTime += input.deltaT;
+            if(shotTime >= timeline.getDuration()) {
+                gameLogic.restore(timeline.getFinalState());
+                shotPlaying = false;
+            }
+        } else if(gameLogic.aiming) {
+            gameLogic.updateGame(input);
+        }
+        if(wasAiming && !gameLogic.aiming) {
+            if(!playingBack)
+                recording.recordShot(beforeShot, {gameLogic.direction, charge});
+            timeline.build(gameLogic);
+            shotPlaying = true;
+            shotTime = 0;
+        }
+        
+        if(gameLogic.aiming && gameLogic.getWinner() == -1) {
+            float aimedCharge = gameLogic.getChargeTime();
+            aimPreview.update(gameLogic, gameLogic.direction, aimedCharge > 0 ? aimedCharge : AIM_PREVIEW_DEFAULT_CHARGE);
+        }
         
         if(gameLogic.aiming) {
             camera.focusOnTarget = true;
@@ -508,17 +673,27 @@ protected:
         DSStick.map(currentImage, &uboStick, sizeof(uboStick), 0);
 
         
-        World = gameLogic.pointerWorldMatrix();
+        AimPrediction prediction;
+        bool showPreview = gameLogic.aiming && gameLogic.getWinner() == -1 && aimPreview.get(prediction);
+        World = showPreview ? gameLogic.pointerWorldMatrix(prediction.cueBall) : glm::scale(glm::mat4(1), glm::vec3(0));
         uboPointer.mvpMat = ViewProjection * World;
         uboPointer.wMat = World;
         uboPointer.nMat = glm::inverse(glm::transpose(World));
         DSPointer.map(currentImage, &uboPointer, sizeof(uboPointer), 0);
         
+        World = showPreview && prediction.objectBall != -1 ? gameLogic.pointerWorldMatrix(prediction.objectEnd)
+                                                           : glm::scale(glm::mat4(1), glm::vec3(0));
+        uboPointerTarget.mvpMat = ViewProjection * World;
+        uboPointerTarget.wMat = World;
+        uboPointerTarget.nMat = glm::inverse(glm::transpose(World));
+        DSPointerTarget.map(currentImage, &uboPointerTarget, sizeof(uboPointerTarget), 0);
+        
         for (int i = 0; i < NUM_BALLS; i++) {
             BallObject &obj = balls[i];
-            obj.ubo.mvpMat = ViewProjection * gameLogic.getBall(i).computeWorldMatrix();
-            obj.ubo.nMat = glm::inverse(glm::transpose(/*viewMatrix(camera) * */ gameLogic.getBall(i).computeWorldMatrix()));
-            obj.ubo.wMat = gameLogic.getBall(i).computeWorldMatrix();
+            Ball ball = shotPlaying ? timeline.ballAt(i, shotTime) : gameLogic.getBall(i);
+            obj.ubo.mvpMat = ViewProjection * ball.computeWorldMatrix();
+            obj.ubo.nMat = glm::inverse(glm::transpose(/*viewMatrix(camera) * */ ball.computeWorldMatrix()));
+            obj.ubo.wMat = ball.computeWorldMatrix();
             obj.descriptorSet.map(currentImage, &obj.ubo, sizeof(obj.ubo), 0);
         }
         
@@ -550,8 +725,33 @@ protected:
 
 
 // This is the main: probably you do not need to touch this!
-int main() {
+int main(int argc, char** argv) {
     Billiards app;
+    // Billiards [--ai] [--replay FILE] [--record-input FILE] [--play-input FILE [--frame-times FILE]] [--telemetry FILE]
+    // --ai hands the second player to the computer, --replay plays a recorded game back,
+    // --record-input captures the session frame by frame,
+    // --play-input plays a captured session back as a benchmark, printing its frame times,
+    // it needs --ai if the session was recorded with it,
+    // and --telemetry streams the contacts, pockets, fouls and turns of the session to a file.
+    for(int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if(option == "--ai")
+            app.player2IsAI = true;
+        else if(i + 1 == argc)
+            std::cerr << "missing the file of " << option << std::endl;
+        else if(option == "--replay")
+            app.replayPath = argv[++i];
+        else if(option == "--record-input")
+            app.recordInputPath = argv[++i];
+        else if(option == "--play-input")
+            app.playInputPath = argv[++i];
+        else if(option == "--frame-times")
+            app.frameTimesPath = argv[++i];
+        else if(option == "--telemetry")
+            app.telemetryPath = argv[++i];
+        else
+            std::cerr << "unknown option " << option << std::endl;
+    }
 
     try {
         app.run();
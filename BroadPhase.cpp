@@ -0,0 +1,61 @@
+// first, so that its floating point rules also cover the inline code of the headers after it.
+#include "PortableMath.hpp"
+#include "GameLogic.hpp"
+#include <algorithm>
+
+void UniformGrid::init(float diameter) {
+    float width = TABLE_TOP_EDGE - TABLE_BOTTOM_EDGE;
+    float length = TABLE_RIGHT_EDGE - TABLE_LEFT_EDGE;
+    cellSize = diameter;
+    // cells can always be larger than a ball, just not more numerous than we have room for.
+    while ((int)std::ceil(width / cellSize) * (int)std::ceil(length / cellSize) > MAX_GRID_CELLS)
+        cellSize *= 1.25f;
+    columns = std::max(1, (int)std::ceil(width / cellSize));
+    rows = std::max(1, (int)std::ceil(length / cellSize));
+}
+
+int UniformGrid::cellOf(float x, float y) {
+    // balls can be slightly past a cushion before it pushes them back.
+    int column = std::clamp((int)((x - TABLE_BOTTOM_EDGE) / cellSize), 0, columns - 1);
+    int row = std::clamp((int)((y - TABLE_LEFT_EDGE) / cellSize), 0, rows - 1);
+    return row * columns + column;
+}
+
+void UniformGrid::build(const BallPhysics& physics, int numBalls) {
+    int numCells = columns * rows;
+    std::fill(cellStart, cellStart + numCells + 1, 0);
+    for (int i = 0; i < numBalls; i++) {
+        if (physics.active[i])
+            cellStart[cellOf(physics.x[i], physics.y[i]) + 1]++;
+    }
+    for (int c = 0; c < numCells; c++)
+        cellStart[c + 1] += cellStart[c];
+    
+    // cellStart[c] temporarily tracks where the next ball of cell c - 1 goes.
+    for (int i = 0; i < numBalls; i++) {
+        if (physics.active[i])
+            entries[cellStart[cellOf(physics.x[i], physics.y[i])]++] = i;
+    }
+    for (int c = numCells; c > 0; c--)
+        cellStart[c] = cellStart[c - 1];
+    cellStart[0] = 0;
+}
+
+int UniformGrid::candidates(const BallPhysics& physics, int ball, int* out) {
+    int cell = cellOf(physics.x[ball], physics.y[ball]);
+    int column = cell % columns;
+    int row = cell / columns;
+    int count = 0;
+    for (int r = std::max(row - 1, 0); r <= std::min(row + 1, rows - 1); r++) {
+        for (int c = std::max(column - 1, 0); c <= std::min(column + 1, columns - 1); c++) {
+            int neighbour = r * columns + c;
+            for (int k = cellStart[neighbour]; k < cellStart[neighbour + 1]; k++) {
+                if (entries[k] > ball)
+                    out[count++] = entries[k];
+            }
+        }
+    }
+    // same order as testing every pair.
+    std::sort(out, out + count);
+    return count;
+}
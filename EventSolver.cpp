@@ -0,0 +1,272 @@
+// first, so that its floating point rules also cover the inline code of the headers after it.
+#include "PortableMath.hpp"
+#include "GameLogic.hpp"
+#include <algorithm>
+
+/*
+    Event-driven solver.
+    Between two events every ball decelerates uniformly by FRICTION_FACTOR along its velocity,
+    so its position is p(t) = p + v * t + acc * t^2 / 2 with acc = -FRICTION_FACTOR * normalize(v).
+    Contacts are then the roots of low degree polynomials in t, which we solve for directly
+    instead of looking for overlaps after every frame.
+    Each ball keeps the start of its current parabola in physics, and only the balls an event
+    touches are brought forward to its time. Nothing is integrated frame by frame.
+ */
+
+const int MAX_POLYNOMIAL_DEGREE = 4;
+const double ROOT_TOLERANCE = 1e-9; // seconds.
+const float MIN_CLOSING_SPEED = 1e-4f;
+
+static double evaluatePolynomial(const double* c, int degree, double t) {
+    double result = 0;
+    for (int i = degree; i >= 0; i--)
+        result = result * t + c[i];
+    return result;
+}
+
+static double bisect(const double* c, int degree, double lo, double hi) {
+    double fLo = evaluatePolynomial(c, degree, lo);
+    while (hi - lo > ROOT_TOLERANCE) {
+        double mid = (lo + hi) / 2;
+        double fMid = evaluatePolynomial(c, degree, mid);
+        if ((fMid < 0) == (fLo < 0)) {
+            lo = mid;
+            fLo = fMid;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo + hi) / 2;
+}
+
+// Finds the real roots of c[0] + c[1] t + ... + c[degree] t^degree in [lo, hi], in ascending order.
+// The roots of the derivative split the range into monotone pieces, each holding at most one root.
+// Only +, *, / and comparisons are used so the result does not depend on the platform's libm.
+static int polynomialRoots(const double* c, int degree, double lo, double hi, double* roots) {
+    while (degree > 0 && c[degree] == 0)
+        degree--;
+    if (degree == 0)
+        return 0;
+    if (degree == 1) {
+        double t = -c[0] / c[1];
+        if (t < lo || t > hi)
+            return 0;
+        roots[0] = t;
+        return 1;
+    }
+
+    double derivative[MAX_POLYNOMIAL_DEGREE] = {};
+    for (int i = 1; i <= degree; i++)
+        derivative[i - 1] = c[i] * i;
+
+    double bounds[MAX_POLYNOMIAL_DEGREE + 1];
+    bounds[0] = lo;
+    int numBounds = 1 + polynomialRoots(derivative, degree - 1, lo, hi, bounds + 1);
+    bounds[numBounds++] = hi;
+
+    int numRoots = 0;
+    for (int i = 0; i + 1 < numBounds; i++) {
+        double a = bounds[i];
+        double b = bounds[i + 1];
+        double fa = evaluatePolynomial(c, degree, a);
+        double fb = evaluatePolynomial(c, degree, b);
+        if (fa == 0) {
+            if (numRoots == 0 || roots[numRoots - 1] != a)
+                roots[numRoots++] = a;
+        } else if (fb != 0 && (fa < 0) != (fb < 0)) {
+            roots[numRoots++] = bisect(c, degree, a, b);
+        }
+    }
+    double fHi = evaluatePolynomial(c, degree, hi);
+    if (fHi == 0 && (numRoots == 0 || roots[numRoots - 1] != hi))
+        roots[numRoots++] = hi;
+    return numRoots;
+}
+
+// First time in [0, horizon] at which f goes from positive to non-positive, or -1 if it never does.
+static double firstEntry(const double* c, int degree, double horizon) {
+    double roots[MAX_POLYNOMIAL_DEGREE];
+    int numRoots = polynomialRoots(c, degree, 0, horizon, roots);
+    for (int i = 0; i < numRoots; i++) {
+        // the root is an entry if f is decreasing through it.
+        double after = std::min(roots[i] + 1e-6, horizon);
+        double before = std::max(roots[i] - 1e-6, 0.0);
+        if (evaluatePolynomial(c, degree, after) < evaluatePolynomial(c, degree, before))
+            return roots[i];
+    }
+    return -1;
+}
+
+static glm::vec2 frictionAcceleration(glm::vec2 velocity) {
+    if (glm::length(velocity) == 0)
+        return glm::vec2(0);
+    return -glm::normalize(velocity) * FRICTION_FACTOR;
+}
+
+static float stopTime(glm::vec2 velocity) {
+    return glm::length(velocity) / FRICTION_FACTOR;
+}
+
+// Coefficients of |d + v t + a t^2 / 2|^2 - r^2.
+static void distanceSquaredPolynomial(glm::vec2 d, glm::vec2 v, glm::vec2 a, float r, double* c) {
+    glm::dvec2 D = d, V = v, B = glm::dvec2(a) / 2.0;
+    c[0] = glm::dot(D, D) - double(r) * r;
+    c[1] = 2 * glm::dot(D, V);
+    c[2] = glm::dot(V, V) + 2 * glm::dot(D, B);
+    c[3] = 2 * glm::dot(V, B);
+    c[4] = glm::dot(B, B);
+}
+
+// the first event after now. Its time is on the shot clock, every ball must be on its segment at now.
+PhysicsEvent GameLogic::predictNextEvent(float now) {
+    PhysicsEvent best;
+    auto consider = [&best](PhysicsEvent::Type type, double time, int ball, int other) {
+        if (time < 0 || (best.type != PhysicsEvent::NONE && time >= best.time))
+            return;
+        best.type = type;
+        best.time = time;
+        best.ball = ball;
+        best.other = other;
+    };
+
+    // the state of every ball at now, predictions below are relative to it.
+    glm::vec2 positions[MAX_BALLS];
+    glm::vec2 velocities[MAX_BALLS];
+    float stops[MAX_BALLS];
+    for (int i = 0; i < numBalls; i++) {
+        positions[i] = positionAt(i, now);
+        velocities[i] = velocityAt(i, now);
+        stops[i] = stopTime(velocities[i]);
+        // timed from the start of the segment, a ball that ran out of speed since is stopped right away.
+        if (physics.active[i] && velocityOf(i) != glm::vec2(0))
+            consider(PhysicsEvent::STOP, std::max(0.0f, segmentStart(i) + stopTime(velocityOf(i)) - now), i, -1);
+    }
+
+    for (int i = 0; i < numBalls; i++) {
+        if (!physics.active[i] || stops[i] == 0)
+            continue;
+        glm::vec2 position = positions[i];
+        glm::vec2 velocity = velocities[i];
+        float radius = physics.radius[i];
+        glm::vec2 acc = frictionAcceleration(velocity);
+
+        // cushions. The velocity never changes sign before the ball stops so only the edge ahead matters.
+        if (velocity.x != 0) {
+            float edge = velocity.x > 0 ? TABLE_TOP_EDGE - radius : TABLE_BOTTOM_EDGE + radius;
+            double sign = velocity.x > 0 ? -1 : 1;
+            double c[3] = {sign * (position.x - edge), sign * velocity.x, sign * acc.x / 2};
+            consider(PhysicsEvent::CUSHION_X, c[0] <= 0 ? 0 : firstEntry(c, 2, best.time), i, -1);
+        }
+        if (velocity.y != 0) {
+            float edge = velocity.y > 0 ? TABLE_RIGHT_EDGE - radius : TABLE_LEFT_EDGE + radius;
+            double sign = velocity.y > 0 ? -1 : 1;
+            double c[3] = {sign * (position.y - edge), sign * velocity.y, sign * acc.y / 2};
+            consider(PhysicsEvent::CUSHION_Y, c[0] <= 0 ? 0 : firstEntry(c, 2, best.time), i, -1);
+        }
+
+        // pockets
+        float reach = glm::length(velocity) * best.time;
+        for (int h = 0; h < 6; h++) {
+            if (glm::distance(position, holes[h].position) - holes[h].radius > reach)
+                continue;
+            double c[5];
+            distanceSquaredPolynomial(position - holes[h].position, velocity, acc, holes[h].radius, c);
+            consider(PhysicsEvent::POCKET, c[0] < 0 ? 0 : firstEntry(c, 4, best.time), i, h);
+        }
+    }
+
+    // other balls
+    for (int i = 0; i < numBalls - 1; i++) {
+        if (!physics.active[i])
+            continue;
+        for (int j = i + 1; j < numBalls; j++) {
+            if (!physics.active[j] || (stops[i] == 0 && stops[j] == 0))
+                continue;
+            glm::vec2 d = positions[j] - positions[i];
+            glm::vec2 v = velocities[j] - velocities[i];
+            float contact = physics.radius[i] + physics.radius[j];
+            // cheap rejection: the gap can't close faster than the two speeds combined.
+            float reach = (glm::length(velocities[i]) + glm::length(velocities[j])) * best.time;
+            if (glm::length(d) - contact > reach)
+                continue;
+            double c[5];
+            distanceSquaredPolynomial(d, v, frictionAcceleration(velocities[j]) - frictionAcceleration(velocities[i]), contact, c);
+            if (c[0] <= 0) {
+                // already touching, only a collision if they are closing in. Rounding can leave a
+                // vanishing closing speed after a glancing contact, which must not trigger again.
+                if (glm::dot(d, v) < -MIN_CLOSING_SPEED * glm::length(d))
+                    consider(PhysicsEvent::BALL_BALL, 0, i, j);
+                continue;
+            }
+            // best.time is never past the first STOP, after which the equations would no longer hold.
+            consider(PhysicsEvent::BALL_BALL, firstEntry(c, 4, best.time), i, j);
+        }
+    }
+
+    if (best.type != PhysicsEvent::NONE)
+        best.time += now;
+    return best;
+}
+
+void GameLogic::resolveEvent(const PhysicsEvent& event) {
+    int i = event.ball;
+    float radius = physics.radius[i];
+    materialize(i, event.time);
+    if (event.type == PhysicsEvent::BALL_BALL)
+        materialize(event.other, event.time);
+    switch (event.type) {
+        case PhysicsEvent::BALL_BALL:
+            handleBallCollision(i, event.other);
+            settle(i);
+            settle(event.other);
+            break;
+        case PhysicsEvent::CUSHION_X:
+            physics.x[i] = physics.vx[i] > 0 ? TABLE_TOP_EDGE - radius : TABLE_BOTTOM_EDGE + radius;
+            physics.vx[i] = -physics.vx[i];
+            report(TelemetryEvent::CUSHION, i, 0, positionOf(i), glm::length(velocityOf(i)));
+            break;
+        case PhysicsEvent::CUSHION_Y:
+            physics.y[i] = physics.vy[i] > 0 ? TABLE_RIGHT_EDGE - radius : TABLE_LEFT_EDGE + radius;
+            physics.vy[i] = -physics.vy[i];
+            report(TelemetryEvent::CUSHION, i, 1, positionOf(i), glm::length(velocityOf(i)));
+            break;
+        case PhysicsEvent::POCKET:
+            handleScore(i, event.other);
+            break;
+        case PhysicsEvent::STOP:
+            setVelocity(i, glm::vec2(0));
+            settle(i);
+            break;
+        case PhysicsEvent::NONE:
+            break;
+    }
+}
+
+float GameLogic::advanceEvents(float deltaT) {
+    float now = shotClock;
+    float end = shotClock + deltaT;
+    bool capped = true;
+    for (int i = 0; i < MAX_EVENTS_PER_FRAME; i++) {
+        if (eventsDirty) {
+            nextEvent = predictNextEvent(now);
+            eventsDirty = false;
+        }
+        if (nextEvent.type == PhysicsEvent::NONE || nextEvent.time > end) {
+            capped = false;
+            break;
+        }
+        now = std::max(now, nextEvent.time);
+        resolveEvent(nextEvent);
+        eventsDirty = true;
+    }
+    // out of events for this frame: the clock stops at the last one resolved, not past events still to come,
+    // and the next frame carries on from there.
+    float elapsed = capped ? now - shotClock : deltaT;
+
+    // apply animation
+    for (int i = 0; i < numBalls; i++) {
+        if(balls[i].animatingFall)
+            applyAnimation(i, elapsed);
+    }
+    return elapsed;
+}
@@ -1,37 +1,233 @@
+// first, so that its floating point rules also cover the inline code of the headers after it.
+#include "PortableMath.hpp"
 #include "GameLogic.hpp"
-#include <iostream>
-
-/*
-    In the logical plane, every ball has a diameter of 1 unit.
-    The table is 20x10, occupying the space between (-5, -10) and (5, 10).
-    A ball's position denotes the position of its centre.
- */
-const float TABLE_BOTTOM_EDGE = -9.5;
-const float TABLE_TOP_EDGE = 9.5;
-const float TABLE_LEFT_EDGE = -16.5;
-const float TABLE_RIGHT_EDGE = 16.5;
-
-void GameLogic::initBalls() {
-    for (int i = 0; i < NUM_BALLS; i++) {
+#include "PhysicsKernels.hpp"
+#include <algorithm>
+
+void GameLogic::initBalls(int count) {
+    numBalls = std::clamp(count, 1, MAX_BALLS);
+    physics = BallPhysics();
+    awake = ActiveSet();
+    for (int i = 0; i < numBalls; i++) {
+        balls[i] = Ball();
         balls[i].id = i;
+        physics.active[i] = -1;
     }
+    
+    if (numBalls == NUM_BALLS)
+        initRack();
+    else
+        initLattice();
+    
+    float diameter = 0;
+    for (int i = 0; i < numBalls; i++) {
+        physics.radius[i] = balls[i].radius;
+        diameter = std::max(diameter, 2 * balls[i].radius);
+    }
+    grid.init(diameter);
+}
 
-    balls[0].position = glm::vec2(0,    -6);
-    balls[1].position = glm::vec2(0,    1 + 0);
-    balls[2].position = glm::vec2(1,    1 + sqrt(3));
-    balls[3].position = glm::vec2(-1,   1 + sqrt(3));
-    balls[4].position = glm::vec2(2,    1 + 2 * sqrt(3));
-    balls[5].position = glm::vec2(0,    1 + 2 * sqrt(3));
-    balls[6].position = glm::vec2(-2,   1 + 2 * sqrt(3));
-    balls[7].position = glm::vec2(3,    1 + 3 * sqrt(3));
-    balls[8].position = glm::vec2(1,    1 + 3 * sqrt(3));
-    balls[9].position = glm::vec2(-1,   1 + 3 * sqrt(3));
-    balls[10].position = glm::vec2(-3,  1 + 3 * sqrt(3));
-    balls[11].position = glm::vec2(4,   1 + 4 * sqrt(3));
-    balls[12].position = glm::vec2(2,   1 + 4 * sqrt(3));
-    balls[13].position = glm::vec2(0,   1 + 4 * sqrt(3));
-    balls[14].position = glm::vec2(-2,  1 + 4 * sqrt(3));
-    balls[15].position = glm::vec2(-4,  1 + 4 * sqrt(3));
+void GameLogic::initRack() {
+    setPosition(0,  glm::vec2(0,    -6));
+    setPosition(1,  glm::vec2(0,    1 + 0));
+    setPosition(2,  glm::vec2(1,    1 + sqrt(3)));
+    setPosition(3,  glm::vec2(-1,   1 + sqrt(3)));
+    setPosition(4,  glm::vec2(2,    1 + 2 * sqrt(3)));
+    setPosition(5,  glm::vec2(0,    1 + 2 * sqrt(3)));
+    setPosition(6,  glm::vec2(-2,   1 + 2 * sqrt(3)));
+    setPosition(7,  glm::vec2(3,    1 + 3 * sqrt(3)));
+    setPosition(8,  glm::vec2(1,    1 + 3 * sqrt(3)));
+    setPosition(9,  glm::vec2(-1,   1 + 3 * sqrt(3)));
+    setPosition(10, glm::vec2(-3,   1 + 3 * sqrt(3)));
+    setPosition(11, glm::vec2(4,    1 + 4 * sqrt(3)));
+    setPosition(12, glm::vec2(2,    1 + 4 * sqrt(3)));
+    setPosition(13, glm::vec2(0,    1 + 4 * sqrt(3)));
+    setPosition(14, glm::vec2(-2,   1 + 4 * sqrt(3)));
+    setPosition(15, glm::vec2(-4,   1 + 4 * sqrt(3)));
+}
+
+// Variant and stress tables: the balls are spread over an even lattice covering the whole table,
+// shrunk so that there are gaps between them, leaving out the cells that would put a ball into a hole.
+void GameLogic::initLattice() {
+    float width = TABLE_TOP_EDGE - TABLE_BOTTOM_EDGE;
+    float length = TABLE_RIGHT_EDGE - TABLE_LEFT_EDGE;
+    float spacing = sqrt(width * length / numBalls);
+    std::vector<glm::vec2> cells;
+    float radius;
+    for (;;) {
+        int columns = std::max(1, (int)(width / spacing));
+        int rows = std::max(1, (int)(length / spacing));
+        float pitchX = width / columns;
+        float pitchY = length / rows;
+        radius = std::min(1.0f, std::min(pitchX, pitchY) / 2.5f);
+        cells.clear();
+        for (int row = 0; row < rows; row++) {
+            for (int column = 0; column < columns; column++) {
+                glm::vec2 cell(TABLE_BOTTOM_EDGE + (column + 0.5f) * pitchX, TABLE_LEFT_EDGE + (row + 0.5f) * pitchY);
+                bool clear = true;
+                for (auto &hole : holes)
+                    clear = clear && glm::distance(cell, hole.position) >= hole.radius + radius;
+                if (clear)
+                    cells.push_back(cell);
+            }
+        }
+        if ((int)cells.size() >= numBalls)
+            break;
+        spacing *= 0.95f;
+    }
+    
+    for (int i = 0; i < numBalls; i++) {
+        balls[i].radius = radius;
+        setPosition(i, cells[i]);
+    }
+}
+
+// the rotation of a ball after rolling the given distance along its velocity.
+glm::quat rolled(glm::quat rotation, glm::vec2 velocity, float radius, float distance) {
+    if(glm::length(velocity) == 0 || distance <= 0)
+        return rotation;
+    auto axis = glm::normalize(glm::vec3(velocity.y, 0, velocity.x));
+    auto amount = distance / radius / 2;
+    // renormalized so that rounding errors don't pile up over a game.
+    return glm::normalize(glm::angleAxis(-amount, axis) * rotation);
+}
+
+Ball GameLogic::getBall(int index) {
+    Ball ball = balls[index];
+    // the event-driven solver only rolls a ball once its segment ends, the rest is worked out here.
+    if (solver == EVENT_DRIVEN && trackRotation && physics.active[index])
+        ball.rotation = rolled(ball.rotation, velocityOf(index), physics.radius[index], distanceAt(index, shotClock));
+    ball.position = positionAt(index, shotClock);
+    ball.velocity = velocityAt(index, shotClock);
+    ball.radius = physics.radius[index];
+    return ball;
+}
+
+// how long the ball has moved along its segment by the given time, it stands still once it stopped.
+float GameLogic::segmentTime(int ball, float time) const {
+    return std::clamp(time - segmentStart(ball), 0.0f, glm::length(velocityOf(ball)) / FRICTION_FACTOR);
+}
+
+float GameLogic::distanceAt(int ball, float time) const {
+    float t = segmentTime(ball, time);
+    return glm::length(velocityOf(ball)) * t - FRICTION_FACTOR * t * t / 2;
+}
+
+glm::vec2 GameLogic::positionAt(int ball, float time) const {
+    float t = segmentTime(ball, time);
+    // falling balls are animated towards their hole rather than rolling.
+    if (!physics.active[ball] || t == 0)
+        return positionOf(ball);
+    glm::vec2 velocity = velocityOf(ball);
+    glm::vec2 acc = -glm::normalize(velocity) * FRICTION_FACTOR;
+    return positionOf(ball) + velocity * t + acc * t * t / 2.0f;
+}
+
+glm::vec2 GameLogic::velocityAt(int ball, float time) const {
+    float t = segmentTime(ball, time);
+    glm::vec2 velocity = velocityOf(ball);
+    if (!physics.active[ball] || t == 0)
+        return velocity;
+    float speed = glm::length(velocity);
+    if (t >= speed / FRICTION_FACTOR)
+        return glm::vec2(0);
+    return velocity * ((speed - FRICTION_FACTOR * t) / speed);
+}
+
+// starts a new segment at the given time from where the ball is by then, before its motion changes.
+void GameLogic::materialize(int ball, float time) {
+    if (physics.active[ball]) {
+        rollBall(ball, distanceAt(ball, time));
+        glm::vec2 position = positionAt(ball, time);
+        glm::vec2 velocity = velocityAt(ball, time);
+        setPosition(ball, position);
+        physics.vx[ball] = velocity.x;
+        physics.vy[ball] = velocity.y;
+    }
+    physics.start[ball] = time;
+}
+
+void GameLogic::save(GameState& state) const {
+    state.numBalls = numBalls;
+    state.direction = direction;
+    state.chargeTime = chargeTime;
+    state.physicsAccumulator = physicsAccumulator;
+    state.shotClock = shotClock;
+    state.currentPlayer = currentPlayer;
+    state.winner = winner;
+    state.p1Color = p1Color;
+    state.flags = (aiming ? GameState::AIMING : 0)
+        | (charging ? GameState::CHARGING : 0)
+        | (colorsChosen ? GameState::COLORS_CHOSEN : 0)
+        | (scoredThisShot ? GameState::SCORED_THIS_SHOT : 0)
+        | (faultThisShot ? GameState::FAULT_THIS_SHOT : 0)
+        | (touchedABallThisShot ? GameState::TOUCHED_A_BALL_THIS_SHOT : 0)
+        | (firstShot ? GameState::FIRST_SHOT : 0)
+        | (eventsDirty ? GameState::EVENTS_DIRTY : 0);
+    state.nextEvent = nextEvent;
+    
+    for (int i = 0; i < numBalls; i++) {
+        BallState& ball = state.balls[i];
+        ball.rotation = balls[i].rotation;
+        ball.x = physics.x[i];
+        ball.y = physics.y[i];
+        ball.vx = physics.vx[i];
+        ball.vy = physics.vy[i];
+        ball.radius = physics.radius[i];
+        ball.start = physics.start[i];
+        ball.inHole = balls[i].inHole;
+        ball.flags = (balls[i].animatingFall ? BallState::ANIMATING_FALL : 0)
+            | (balls[i].hide ? BallState::HIDE : 0)
+            | (awake.contains(i) ? BallState::AWAKE : 0);
+    }
+}
+
+void GameLogic::restore(const GameState& state) {
+    int previousBalls = numBalls;
+    numBalls = state.numBalls;
+    direction = state.direction;
+    chargeTime = state.chargeTime;
+    physicsAccumulator = state.physicsAccumulator;
+    shotClock = state.shotClock;
+    currentPlayer = state.currentPlayer;
+    winner = state.winner;
+    p1Color = (Ball::BallType)state.p1Color;
+    aiming = state.flags & GameState::AIMING;
+    charging = state.flags & GameState::CHARGING;
+    colorsChosen = state.flags & GameState::COLORS_CHOSEN;
+    scoredThisShot = state.flags & GameState::SCORED_THIS_SHOT;
+    faultThisShot = state.flags & GameState::FAULT_THIS_SHOT;
+    touchedABallThisShot = state.flags & GameState::TOUCHED_A_BALL_THIS_SHOT;
+    firstShot = state.flags & GameState::FIRST_SHOT;
+    eventsDirty = state.flags & GameState::EVENTS_DIRTY;
+    nextEvent = state.nextEvent;
+    
+    awake = ActiveSet();
+    float diameter = 0;
+    for (int i = 0; i < numBalls; i++) {
+        const BallState& ball = state.balls[i];
+        balls[i].id = i;
+        balls[i].rotation = ball.rotation;
+        balls[i].inHole = ball.inHole;
+        balls[i].animatingFall = ball.flags & BallState::ANIMATING_FALL;
+        balls[i].hide = ball.flags & BallState::HIDE;
+        physics.x[i] = ball.x;
+        physics.y[i] = ball.y;
+        physics.vx[i] = ball.vx;
+        physics.vy[i] = ball.vy;
+        physics.radius[i] = ball.radius;
+        physics.start[i] = ball.start;
+        physics.active[i] = ball.inHole == -1 ? -1 : 0;
+        if (ball.flags & BallState::AWAKE)
+            awake.wake(i);
+        diameter = std::max(diameter, 2 * ball.radius);
+    }
+    // lanes left over from a larger table must not take part in the kernels.
+    for (int i = numBalls; i < simdPadded(previousBalls); i++) {
+        physics.x[i] = physics.y[i] = physics.vx[i] = physics.vy[i] = physics.radius[i] = physics.start[i] = 0;
+        physics.active[i] = 0;
+    }
+    grid.init(diameter);
 }
 
 void GameLogic::initHoles() {
@@ -47,23 +243,23 @@ void GameLogic::initHoles() {
     holes[5].position = glm::vec2(9.5, 0);
 }
 
+// every ball that moves or falls is awake, and goes back to sleep in settle() once it stops.
 bool GameLogic::allBallsAreStill() {
-    for(auto &ball : balls) {
-        if (ball.inHole != nullptr) {
-            if(ball.animatingFall)
-                return false;
-        } else {
-            if(ball.velocity.x != 0.0f || ball.velocity.y != 0.0f)
-                return false;
-        }
-    }
-    return true;
+    return awake.count == 0;
+}
+
+void GameLogic::settle(int index) {
+    if (balls[index].animatingFall)
+        return;
+    if (physics.active[index] && (physics.vx[index] != 0.0f || physics.vy[index] != 0.0f))
+        return;
+    awake.sleep(index);
 }
 
 void GameLogic::handle8Pocket(int pocketingPlayer) {
     if(pocketingPlayer == 0) {
-        for (int i = 0; i < NUM_BALLS; i++) {
-            if(balls[i].getType() == p1Color && balls[i].inHole == nullptr) {
+        for (int i = 0; i < numBalls; i++) {
+            if(balls[i].getType() == p1Color && balls[i].inHole == -1) {
                 winner = 1;
                 return;
             }
@@ -72,7 +268,7 @@ void GameLogic::handle8Pocket(int pocketingPlayer) {
         return;
     }
     for (int i = 1; i < 8; i++) {
-        if(balls[i].inHole == nullptr &&
+        if(balls[i].inHole == -1 &&
            (balls[i].getType() != p1Color ||
             balls[i].getType() != Ball::CUE ||
             balls[i].getType() != Ball::EIGHT)
@@ -85,9 +281,14 @@ void GameLogic::handle8Pocket(int pocketingPlayer) {
     return;
 }
 
-void GameLogic::handleScore(Ball& ball, Hole& hole) {
-    ball.inHole = &hole;
+void GameLogic::handleScore(int index, int hole) {
+    Ball& ball = balls[index];
+    ball.inHole = hole;
     ball.animatingFall = true;
+    physics.active[index] = 0;
+    awake.wake(index);
+    recordEvent(GameEvent::POCKET, index, hole);
+    report(TelemetryEvent::POCKET, index, hole, positionOf(index), glm::length(velocityOf(index)));
     
     if (ball.getType() == Ball::CUE) {
         faultThisShot = true;
@@ -113,12 +314,24 @@ void GameLogic::handleScore(Ball& ball, Hole& hole) {
 }
 
 void GameLogic::checkWhetherAnyBallsGoIn() {
-    for( auto &ball : balls) {
-        if (ball.inHole != nullptr)
+    for (int block = 0; block < numBalls; block += SIMD_WIDTH) {
+        if (awake.inBlock(block) == 0)
             continue;
-        for( auto &hole : holes) {
-            if (glm::distance(ball.position, hole.position) < hole.radius) {
-                handleScore(ball, hole);
+        vfloat x = simd::load(physics.x + block);
+        vfloat y = simd::load(physics.y + block);
+        vmask active = simd::loadMask(physics.active + block);
+        unsigned inAnyHole = 0;
+        for (auto &hole : holes)
+            inAnyHole |= simd::bits(simd::maskAnd(active, withinKernel(x, y, simd::set1(hole.position.x), simd::set1(hole.position.y), simd::set1(hole.radius))));
+        
+        // handle them in ball order, the first ball to go in decides the colors.
+        for (; inAnyHole != 0; inAnyHole &= inAnyHole - 1) {
+            int i = block + __builtin_ctz(inAnyHole);
+            for (int h = 0; h < 6; h++) {
+                if (glm::distance(positionOf(i), holes[h].position) < holes[h].radius) {
+                    handleScore(i, h);
+                    break;
+                }
             }
         }
     }
@@ -142,57 +355,240 @@ void GameLogic::updateGame(Input input) {
             if(input.fire) { // still charging
                 chargeTime += input.deltaT;
             } else {    // released
-                charging = false;
-                balls[0].velocity = glm::vec2(cos(glm::radians(direction)), sin(glm::radians(direction))) * chargeTime * HIT_STRENGTH;
-                aiming = false;
-                chargeTime = 0.0f;
+                strike(direction, chargeTime);
             }
         }
     } else {
-        checkWhetherAnyBallsGoIn();
-        computeFrame(input.deltaT);
+        float tick = 1.0f / physicsTickRate;
+        physicsAccumulator += input.deltaT;
+        int substeps = 0;
+        // no ticks past the one the balls stop on, so that the shot clock doesn't depend on the frame rate.
+        while(physicsAccumulator >= tick && substeps < maxSubsteps && !allBallsAreStill()) {
+            stepPhysics(tick);
+            physicsAccumulator -= tick;
+            substeps++;
+        }
+        // in deterministic mode the backlog is caught up over the next frames instead.
+        if(substeps == maxSubsteps && !deterministic)
+            physicsAccumulator = 0.0f;
+        
         if( allBallsAreStill() && winner == -1) {
-            // finished pyhsics simulation
-            if ( !scoredThisShot || faultThisShot) {
-                currentPlayer = 1 - currentPlayer;
-            }
-            
-            if(!touchedABallThisShot)
-                faultThisShot = true;
-            
-            if( faultThisShot) {
-                // TODO animate?
-                balls[0].position = glm::vec2(0,    -6);
-                balls[0].velocity = glm::vec2(0);
-                balls[0].inHole = nullptr;
-                balls[0].hide = false;
-                checkCollisions();
+            finishShot();
+        }
+    }
+}
+
+void GameLogic::strike(float direction, float charge) {
+    this->direction = direction;
+    if(deterministic) {
+        float sine, cosine;
+        portableSinCos(direction, sine, cosine);
+        setVelocity(0, glm::vec2(cosine, sine) * charge * HIT_STRENGTH);
+    } else {
+        setVelocity(0, glm::vec2(cos(glm::radians(direction)), sin(glm::radians(direction))) * charge * HIT_STRENGTH);
+    }
+    aiming = false;
+    charging = false;
+    chargeTime = 0.0f;
+    eventsDirty = true;
+    shotClock = 0.0f;
+    // the balls rest, so every segment can start over with the new shot clock.
+    std::fill(physics.start, physics.start + numBalls, 0.0f);
+    events.clear();
+    if(telemetry.target) {
+        TelemetryEvent event = {TelemetryEvent::STRIKE, (int8_t)currentPlayer, 0, -1, 0, 0, shotClock,
+                                physics.x[0], physics.y[0], charge, direction};
+        telemetry.target->record(event);
+    }
+}
+
+int GameLogic::simulateShot(const StopConditions& stop, int maxTicks) {
+    float tick = 1.0f / physicsTickRate;
+    int ticks = 0;
+    cutShort = false;
+    while(!allBallsAreStill() && ticks < maxTicks) {
+        stepPhysics(tick);
+        ticks++;
+        if(!allBallsAreStill() && shouldStop(stop)) {
+            cutShotShort();
+            cutShort = true;
+        }
+    }
+    if(allBallsAreStill() && winner == -1)
+        finishShot();
+    return ticks;
+}
+
+bool GameLogic::shouldStop(const StopConditions& stop) {
+    if(stopsByRules(stop))
+        return true;
+    if(stop.energyBelow > 0 && kineticEnergy() < stop.energyBelow)
+        return true;
+    return stop.custom && stop.custom(*this);
+}
+
+// the stop conditions that only look at the rules, not at the motion of the balls.
+bool GameLogic::stopsByRules(const StopConditions& stop) {
+    if(stop.eightPocketed && numBalls > 8 && balls[8].inHole != -1)
+        return true;
+    if(stop.scratch && balls[0].inHole != -1)
+        return true;
+    // before the cue ball goes in, the only other way to commit a fault is hitting the wrong ball first.
+    return stop.illegalFirstContact && faultThisShot && balls[0].inHole == -1;
+}
+
+float GameLogic::kineticEnergy() {
+    float energy = 0;
+    for (int block = 0; block < numBalls; block += SIMD_WIDTH) {
+        for (unsigned bits = awake.inBlock(block); bits != 0; bits &= bits - 1) {
+            int i = block + __builtin_ctz(bits);
+            if(physics.active[i]) {
+                glm::vec2 velocity = velocityAt(i, shotClock);
+                energy += (velocity.x * velocity.x + velocity.y * velocity.y) / 2;
             }
-            
-            aiming = true;
-            scoredThisShot = false;
-            faultThisShot = false;
-            touchedABallThisShot = false;
-            firstShot = false;
         }
     }
+    return energy;
 }
 
-void GameLogic::handleBallCollision(Ball& b1, Ball&b2) {
-    glm::vec2 collision_vector = b2.position - b1.position;
-    float correction = (b1.radius + b2.radius - glm::length(collision_vector)) / 2.0;
+// stops every ball where it is and drops the falling ones straight into their hole.
+void GameLogic::cutShotShort() {
+    for (int i = 0; i < numBalls; i++) {
+        if(balls[i].animatingFall) {
+            setPosition(i, holes[balls[i].inHole].position);
+            applyAnimation(i, 0);
+        }
+        if(physics.active[i]) {
+            materialize(i, shotClock);
+            setVelocity(i, glm::vec2(0));
+        }
+        settle(i);
+    }
+    physicsAccumulator = 0.0f;
+    eventsDirty = true;
+}
+
+// scores a shot once all the balls came to rest, and hands over to the next player.
+void GameLogic::finishShot() {
+    int shooter = currentPlayer;
+    if ( !scoredThisShot || faultThisShot) {
+        currentPlayer = 1 - currentPlayer;
+    }
+    
+    if(!touchedABallThisShot)
+        faultThisShot = true;
+    
+    if( faultThisShot) {
+        recordEvent(GameEvent::FOUL, 0);
+        report(TelemetryEvent::FOUL, -1, -1, glm::vec2(0, -6), 0);
+        // TODO animate?
+        setPosition(0, glm::vec2(0,    -6));
+        setVelocity(0, glm::vec2(0));
+        balls[0].inHole = -1;
+        balls[0].hide = false;
+        physics.active[0] = -1;
+        // awake for the collision check, in case it was put back on top of another ball.
+        awake.wake(0);
+        checkCollisions();
+    }
+    
+    aiming = true;
+    physicsAccumulator = 0.0f;
+    scoredThisShot = false;
+    faultThisShot = false;
+    touchedABallThisShot = false;
+    firstShot = false;
+    shotChecksum = checksum();
+    if(currentPlayer != shooter)
+        report(TelemetryEvent::TURN, -1, -1, glm::vec2(0), 0);
+}
+
+// FNV-1a over the bit patterns, field by field so that padding never gets in.
+uint64_t GameLogic::checksum() const {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= ((const unsigned char*)data)[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    int32_t header[] = {numBalls, currentPlayer, winner, colorsChosen ? p1Color : 0, colorsChosen, aiming, firstShot};
+    mix(header, sizeof(header));
+    mix(&shotClock, sizeof(shotClock));
+    for (int i = 0; i < numBalls; i++) {
+        float state[] = {physics.x[i], physics.y[i], physics.vx[i], physics.vy[i], physics.radius[i], physics.start[i]};
+        int32_t flags[] = {balls[i].inHole, balls[i].animatingFall, balls[i].hide, awake.contains(i)};
+        mix(state, sizeof(state));
+        mix(flags, sizeof(flags));
+    }
+    return hash;
+}
+
+void GameLogic::stepPhysics(float deltaT) {
+    if(solver == EVENT_DRIVEN) {
+        deltaT = advanceEvents(deltaT);
+    } else {
+        checkWhetherAnyBallsGoIn();
+        computeFrame(deltaT);
+    }
+    shotClock += deltaT;
+}
+
+// events are timed to the physics tick they happened in.
+void GameLogic::recordEvent(GameEvent::Type type, int ball, int other) {
+    if(recordEvents)
+        events.push_back({type, shotClock, ball, other});
+}
+
+static_assert(MAX_BALLS <= INT16_MAX, "TelemetryEvent holds the index of a ball in 16 bits");
+
+// only a branch while no telemetry is set, the Telemetry itself never blocks.
+void GameLogic::report(TelemetryEvent::Type type, int ball, int other, glm::vec2 where, float value) {
+    if(!telemetry.target)
+        return;
+    TelemetryEvent event = {type, (int8_t)currentPlayer, (int16_t)ball, (int16_t)other, 0, 0, shotClock, where.x, where.y, value, 0};
+    telemetry.target->record(event);
+}
+
+// the balls of the block whose velocity the cushions just turned around.
+void GameLogic::reportCushions(int block, unsigned alongX, unsigned alongY) {
+    for (int lane = 0; lane < SIMD_WIDTH && block + lane < numBalls; lane++) {
+        int i = block + lane;
+        if((alongX >> lane) & 1)
+            report(TelemetryEvent::CUSHION, i, 0, positionOf(i), glm::length(velocityOf(i)));
+        if((alongY >> lane) & 1)
+            report(TelemetryEvent::CUSHION, i, 1, positionOf(i), glm::length(velocityOf(i)));
+    }
+}
+
+void GameLogic::handleBallCollision(int i, int j) {
+    glm::vec2 collision_vector = positionOf(j) - positionOf(i);
+    float correction = (physics.radius[i] + physics.radius[j] - glm::length(collision_vector)) / 2.0;
     glm::vec2 normal = glm::normalize(collision_vector);
-    b1.position += -correction * normal;
-    b2.position += correction * normal;
+    setPosition(i, positionOf(i) - correction * normal);
+    setPosition(j, positionOf(j) + correction * normal);
     
     glm::vec2 tangent = glm::vec2(-normal.y, normal.x);
+    if(telemetry.target)
+        report(TelemetryEvent::BALL_BALL, i, j, positionOf(i) + normal * physics.radius[i],
+               glm::dot(normal, velocityOf(i) - velocityOf(j)));
 
-    auto newB1Velocity = normal * (glm::dot(normal, b2.velocity)) + tangent * glm::dot(tangent, b1.velocity);
-    auto newB2Velocity = normal * (glm::dot(normal, b1.velocity)) + tangent * glm::dot(tangent, b2.velocity);
-    
-    b1.velocity = newB1Velocity;
-    b2.velocity = newB2Velocity;
+    auto newB1Velocity = normal * (glm::dot(normal, velocityOf(j))) + tangent * glm::dot(tangent, velocityOf(i));
+    auto newB2Velocity = normal * (glm::dot(normal, velocityOf(i))) + tangent * glm::dot(tangent, velocityOf(j));
     
+    setVelocity(i, newB1Velocity);
+    setVelocity(j, newB2Velocity);
+    // both were moved apart, even a ball left without speed has to be checked again next step.
+    awake.wake(i);
+    awake.wake(j);
+    handleContactRules(i, j);
+}
+
+// what a contact between two balls means for the rules, the first one the cue ball makes decides the fault.
+void GameLogic::handleContactRules(int i, int j) {
+    Ball& b1 = balls[i];
+    Ball& b2 = balls[j];
+    recordEvent(GameEvent::BALL_BALL, i, j);
     if(b1.getType() == Ball::CUE && !touchedABallThisShot) { // assuming CUE always has smaller id.
         touchedABallThisShot = true;
         if(colorsChosen) {
@@ -203,17 +599,24 @@ void GameLogic::handleBallCollision(Ball& b1, Ball&b2) {
     }
 }
 
-void GameLogic::applyAnimation(Ball& ball, float deltaT) {
-    Hole hole = *ball.inHole;
-    if(glm::distance(ball.position, hole.position) > 0.1) {
-        glm::vec2 direction = glm::normalize( hole.position - ball.position);
-        ball.position += direction * deltaT * glm::length(ball.velocity);
+void GameLogic::applyAnimation(int index, float deltaT) {
+    Ball& ball = balls[index];
+    Hole hole = holes[ball.inHole];
+    glm::vec2 position = positionOf(index);
+    if(glm::distance(position, hole.position) > 0.1) {
+        glm::vec2 direction = glm::normalize( hole.position - position);
+        // don't overshoot the hole when a fast ball falls in.
+        float speed = std::max(glm::length(velocityOf(index)), MIN_FALL_SPEED);
+        float step = std::min(deltaT * speed, glm::distance(position, hole.position));
+        setPosition(index, position + direction * step);
     } else {
         ball.animatingFall = false;
         ball.hide = true;
+        settle(index);
         if(ball.getType() == Ball::EIGHT) {
             handle8Pocket(currentPlayer);
-            std::cout << "Winner: " << winner;
+            recordEvent(GameEvent::WINNER, winner);
+            report(TelemetryEvent::WINNER, -1, winner, hole.position, 0);
         }
     }
         
@@ -221,95 +624,133 @@ void GameLogic::applyAnimation(Ball& ball, float deltaT) {
 
 void GameLogic::checkCollisions() {
     // check edge collisions
-    for(auto &ball : balls) {
-        if(ball.inHole != nullptr)
+    for (int block = 0; block < numBalls; block += SIMD_WIDTH) {
+        if (awake.inBlock(block) == 0)
             continue;
-        
-        if(ball.position.y + ball.radius >= TABLE_RIGHT_EDGE) {
-            ball.position.y = TABLE_RIGHT_EDGE - ball.radius;
-            ball.velocity.y = -ball.velocity.y;
-        }
-        if(ball.position.y - ball.radius <= TABLE_LEFT_EDGE) {
-            ball.position.y = TABLE_LEFT_EDGE + ball.radius;
-            ball.velocity.y = -ball.velocity.y;
-        }
-        if(ball.position.x + ball.radius >= TABLE_TOP_EDGE) {
-            ball.position.x = TABLE_TOP_EDGE - ball.radius;
-            ball.velocity.x = -ball.velocity.x;
-        }
-        if(ball.position.x - ball.radius <= TABLE_BOTTOM_EDGE) {
-            ball.position.x = TABLE_BOTTOM_EDGE + ball.radius;
-            ball.velocity.x = -ball.velocity.x;
-        }
+        vfloat x = simd::load(physics.x + block);
+        vfloat y = simd::load(physics.y + block);
+        vfloat vx = simd::load(physics.vx + block);
+        vfloat vy = simd::load(physics.vy + block);
+        vfloat oldVx = vx, oldVy = vy;
+        cushionKernel(x, y, vx, vy, simd::load(physics.radius + block), simd::loadMask(physics.active + block));
+        simd::store(physics.x + block, x);
+        simd::store(physics.y + block, y);
+        simd::store(physics.vx + block, vx);
+        simd::store(physics.vy + block, vy);
+        if(telemetry.target)
+            reportCushions(block, simd::bits(simd::neq(vx, oldVx)), simd::bits(simd::neq(vy, oldVy)));
     }
     
     // check collisions with other balls
-    for( int i = 0; i < NUM_BALLS - 1; i++) {
-        Ball& b1 = balls[i];
-        if(b1.hide)
+    if(broadPhase == UNIFORM_GRID)
+        checkCollisionsGrid();
+    else
+        checkCollisionsBruteForce();
+}
+
+// two sleeping balls can't have run into each other, so a pair is only tested if one of them is awake.
+void GameLogic::checkCollisionsBruteForce() {
+    for( int i = 0; i < numBalls - 1; i++) {
+        if(!physics.active[i])
             continue;
-        for( int j = i + 1; j < NUM_BALLS; j++) {
-            Ball& b2 = balls[j];
-            if(b2.hide)
-                continue;
-            if(glm::distance(b1.position, b2.position) < b1.radius + b2.radius) {
-                handleBallCollision(b1, b2);
+        for (int block = (i + 1) / SIMD_WIDTH * SIMD_WIDTH; block < numBalls; block += SIMD_WIDTH) {
+            // only the balls after i, as the pairs before were tested from the other side.
+            unsigned candidates = ~0u;
+            if (block <= i)
+                candidates <<= i + 1 - block;
+            unsigned partners = awake.contains(i) ? ~0u : awake.inBlock(block);
+            unsigned hits = candidates & partners & overlapsInBlock(i, block);
+            while (hits != 0) {
+                int j = block + __builtin_ctz(hits);
+                handleBallCollision(i, j);
+                // i moved and is awake now, so the rest of the block has to be tested against its new position.
+                candidates = ~0u << (j + 1 - block);
+                hits = candidates & overlapsInBlock(i, block);
             }
         }
     }
 }
 
+void GameLogic::checkCollisionsGrid() {
+    grid.build(physics, numBalls);
+    int candidates[BALL_CAPACITY];
+    for (int i = 0; i < numBalls - 1; i++) {
+        if(!physics.active[i])
+            continue;
+        int count = grid.candidates(physics, i, candidates);
+        for (int k = 0; k < count; k++) {
+            int j = candidates[k];
+            if (!awake.contains(i) && !awake.contains(j))
+                continue;
+            glm::vec2 d = positionOf(j) - positionOf(i);
+            float reach = physics.radius[i] + physics.radius[j];
+            if(d.x * d.x + d.y * d.y < reach * reach)
+                handleBallCollision(i, j);
+        }
+    }
+}
+
+// bit k is set if ball i overlaps ball block + k.
+unsigned GameLogic::overlapsInBlock(int i, int block) {
+    vmask overlapping = withinKernel(simd::set1(physics.x[i]), simd::set1(physics.y[i]),
+                                     simd::load(physics.x + block), simd::load(physics.y + block),
+                                     simd::add(simd::set1(physics.radius[i]), simd::load(physics.radius + block)));
+    return simd::bits(simd::maskAnd(overlapping, simd::loadMask(physics.active + block)));
+}
+
 void GameLogic::computeFrame(float deltaT) {
     checkCollisions();
     
-    // apply friction
-    for (auto &ball : balls) {
-        if(ball.inHole != nullptr)
+    // apply friction and displacement
+    vfloat deltaV = simd::set1(FRICTION_FACTOR * deltaT);
+    vfloat step = simd::set1(deltaT);
+    for (int block = 0; block < numBalls; block += SIMD_WIDTH) {
+        unsigned awakeInBlock = awake.inBlock(block);
+        if (awakeInBlock == 0)
             continue;
-        if(glm::length(ball.velocity) > 0){
-            auto deltaV = glm::normalize(ball.velocity) * FRICTION_FACTOR * deltaT;
-            auto newVelocity = ball.velocity - deltaV;
-            // if the sign has changed.
-            if(ball.velocity.x * newVelocity.x < 0.0f || ball.velocity.y * newVelocity.y < 0.0f)
-                ball.velocity = glm::vec2(0);
-            else
-                ball.velocity = newVelocity;
-        }
-    }
+        vfloat x = simd::load(physics.x + block);
+        vfloat y = simd::load(physics.y + block);
+        vfloat vx = simd::load(physics.vx + block);
+        vfloat vy = simd::load(physics.vy + block);
+        vmask active = simd::loadMask(physics.active + block);
+        frictionKernel(vx, vy, active, deltaV);
+        displacementKernel(x, y, vx, vy, active, step);
+        simd::store(physics.x + block, x);
+        simd::store(physics.y + block, y);
+        simd::store(physics.vx + block, vx);
+        simd::store(physics.vy + block, vy);
         
-    // apply displacement
-    for (auto &ball : balls) {
-        if(ball.inHole != nullptr)
-            continue;
-        ball.position += deltaT * ball.velocity;
-    }
-    
-    // apply animation
-    for (auto &ball : balls) {
-        if(ball.animatingFall)
-            applyAnimation(ball, deltaT);
+        // put the balls on the table that came to a stop to sleep.
+        vfloat zero = simd::set1(0);
+        unsigned moving = simd::bits(simd::maskOr(simd::neq(vx, zero), simd::neq(vy, zero)));
+        for (unsigned stopped = awakeInBlock & simd::bits(active) & ~moving; stopped != 0; stopped &= stopped - 1)
+            awake.sleep(block + __builtin_ctz(stopped));
     }
     
-    // apply rotation
-    for(auto &ball : balls) {
-        if(glm::length(ball.velocity) > 0) {
-            auto axis = glm::vec3(ball.velocity.y, 0, ball.velocity.x);
-            auto amount = glm::length(ball.velocity) * deltaT / ball.radius / 2;
-
-                
-            auto rotator = glm::rotate(glm::mat4(1), -amount, axis);
-
-            ball.rotation = rotator * ball.rotation;
+    // apply animation and rotation, only awake balls can be falling or moving.
+    for (int block = 0; block < numBalls; block += SIMD_WIDTH) {
+        for (unsigned bits = awake.inBlock(block); bits != 0; bits &= bits - 1) {
+            int i = block + __builtin_ctz(bits);
+            if(balls[i].animatingFall)
+                applyAnimation(i, deltaT);
+            rollBall(i, glm::length(velocityOf(i)) * deltaT);
         }
     }
     
 }
 
+// rotates the ball as if it rolled the given distance along its velocity.
+void GameLogic::rollBall(int index, float distance) {
+    if(!trackRotation)
+        return;
+    balls[index].rotation = rolled(balls[index].rotation, velocityOf(index), physics.radius[index], distance);
+}
+
 glm::mat4 GameLogic::computeStickWorldMatrix() {
     if(!aiming)
         return glm::scale(glm::mat4(1), glm::vec3(0,0,0));
     
-    return balls[0].computeTranslationMatrix() // move it next to the ball.
+    return getBall(0).computeTranslationMatrix() // move it next to the ball.
     * glm::rotate(glm::mat4(1), glm::radians(direction), glm::vec3(0,1,0)) // rotate around origin
     * glm::translate(glm::mat4(1), glm::vec3(-(ARROW_DISTANCE + chargeTime * ARROW_ELONGATE_FACTOR), 0, 0))    // move it away from the origin
     * glm::rotate(glm::mat4(1), glm::radians(90.0f), glm::vec3(0,1,0)); // orient the arrow horizontally.
@@ -317,16 +758,12 @@ glm::mat4 GameLogic::computeStickWorldMatrix() {
 
 // --------- Testing
 void GameLogic::setRandomBallVelocities() {
-    for (auto &ball : balls) {
-        ball.velocity = glm::vec2(rand() % 4 - 2 , rand() % 4 - 2) * 3.0f;
+    for (int i = 0; i < numBalls; i++) {
+        setVelocity(i, glm::vec2(rand() % 4 - 2 , rand() % 4 - 2) * 3.0f);
     }
 }
 
-glm::mat4 GameLogic::pointerWorldMatrix() {
-    return glm::scale(glm::mat4(1), glm::vec3(0,0,0));
-    
-    auto hole = holes[1];
-    
-    return glm::translate(glm::mat4(1), glm::vec3(hole.position.x / 2, BALL_HEIGHT, -hole.position.y / 2))
-        * glm::scale(glm::mat4(1), glm::vec3(BALL_SCALE * hole.radius));
+glm::mat4 GameLogic::pointerWorldMatrix(glm::vec2 position) {
+    return glm::translate(glm::mat4(1), glm::vec3(position.x / 2, BALL_HEIGHT, -position.y / 2))
+        * glm::scale(glm::mat4(1), glm::vec3(BALL_SCALE * physics.radius[0] * AIM_GHOST_SCALE));
 }
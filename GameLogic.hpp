@@ -6,78 +6,267 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include "Ball.hpp"
 #include "Input.hpp"
+#include "Simd.hpp"
+#include "Telemetry.hpp"
+#include <functional>
+#include <type_traits>
+#include <vector>
 
 const int NUM_BALLS = 16;
-const float BALL_HEIGHT = 0.5f;
-const float BALL_SCALE = 0.4;
+// upper bound for variant and stress tables, only the first NUM_BALLS are ever rendered.
+#ifdef BILLIARDS_MAX_BALLS
+const int MAX_BALLS = BILLIARDS_MAX_BALLS;
+#else
+const int MAX_BALLS = NUM_BALLS;
+#endif
 const float FRICTION_FACTOR = 1;
 const float HIT_STRENGTH = 7.5f;
 const float ROTATE_SPEED = 90.0f;
 const float ARROW_DISTANCE = 0.5f;
 const float ARROW_ELONGATE_FACTOR = 1.0f;
+const float AIM_GHOST_SCALE = 0.5f; // the ghost balls of the aim preview are drawn smaller than the real ones.
+const int MAX_EVENTS_PER_FRAME = 256;
+const int DEFAULT_PHYSICS_TICK_RATE = 480; // in Hz.
+const int DEFAULT_MAX_SUBSTEPS = 32;
+const float MIN_FALL_SPEED = 2.0f; // units/s, so that a ball that barely rolled into a hole still drops.
+const float DEFAULT_ROLLOUT_ENERGY = 2.0f; // one ball rolling at 2 units/s, which stops within a ball diameter.
 
-struct Hole
+/*
+    In the logical plane, every ball has a diameter of 1 unit.
+    The table is 20x10, occupying the space between (-5, -10) and (5, 10).
+    A ball's position denotes the position of its centre.
+ */
+const float TABLE_BOTTOM_EDGE = -9.5;
+const float TABLE_TOP_EDGE = 9.5;
+const float TABLE_LEFT_EDGE = -16.5;
+const float TABLE_RIGHT_EDGE = 16.5;
+
+const int BALL_CAPACITY = simdPadded(MAX_BALLS);
+
+// The state touched by the physics step every tick, stored one component per array so the kernels
+// in PhysicsKernels.hpp can process SIMD_WIDTH balls per instruction. Padding lanes stay inactive.
+struct BallPhysics
 {
-    glm::vec2 position;
-    float radius = 1.5;
+    alignas(64) float x[BALL_CAPACITY] = {};
+    alignas(64) float y[BALL_CAPACITY] = {};
+    alignas(64) float vx[BALL_CAPACITY] = {};
+    alignas(64) float vy[BALL_CAPACITY] = {};
+    alignas(64) float radius[BALL_CAPACITY] = {};
+    alignas(64) int32_t active[BALL_CAPACITY] = {}; // -1 while the ball is on the table, 0 once it fell in.
+    // event-driven solver only: the shot clock time at which x, y, vx and vy hold, see GameLogic::positionAt.
+    alignas(64) float start[BALL_CAPACITY] = {};
 };
 
-struct Ball
+// The balls the physics step has to look at: moving, just touched by another ball, or falling into a hole.
+// Balls at rest are asleep, and a SIMD block in which every ball sleeps is skipped altogether.
+struct ActiveSet
 {
-    int id = -1;
-    glm::vec2 position;
-    glm::mat4 rotation = glm::mat4(1);
-    glm::vec2 velocity = glm::vec2(0);
-    float radius = 1; // in logical units.
-    Hole* inHole = nullptr;
-    bool animatingFall = false;
-    bool hide = false;
-    
-    enum BallType {CUE, EIGHT, FULL, STRIPE};
-
-    BallType getType() {
-        if(id == 0) return CUE;
-        if(id < 8) return FULL;
-        if(id == 8) return EIGHT;
-        return STRIPE;
-    }
+    uint64_t bits[(BALL_CAPACITY + 63) / 64] = {};
+    int count = 0;
     
-    glm::mat4 computeWorldMatrix() {
-        if(hide)
-            return glm::scale(glm::mat4(1), glm::vec3(0));
-        
-        return computeTranslationMatrix() * glm::mat4(rotation) * glm::scale(glm::mat4(1), glm::vec3(BALL_SCALE * radius));
+    bool contains(int ball) const {return (bits[ball / 64] >> (ball % 64)) & 1;}
+    void wake(int ball) {
+        if (contains(ball))
+            return;
+        bits[ball / 64] |= uint64_t(1) << (ball % 64);
+        count++;
     }
-    
-    glm::mat4 computeTranslationMatrix() {
-        return glm::translate(glm::mat4(1), glm::vec3(position.x / 2, BALL_HEIGHT, -position.y / 2));
+    void sleep(int ball) {
+        if (!contains(ball))
+            return;
+        bits[ball / 64] &= ~(uint64_t(1) << (ball % 64));
+        count--;
+    }
+    // bit k is set if ball block + k is awake. Blocks never straddle two words as SIMD_WIDTH divides 64.
+    unsigned inBlock(int block) const {
+        return unsigned(bits[block / 64] >> (block % 64)) & unsigned((uint64_t(1) << SIMD_WIDTH) - 1);
     }
 };
 
+// Broad phase bucketing the balls into square cells at least one ball diameter wide,
+// so that only balls in neighbouring cells can touch. Rebuilt with a counting sort every step.
+const int MAX_GRID_CELLS = 4 * BALL_CAPACITY + 256;
+struct UniformGrid
+{
+    float cellSize = 2;
+    int columns = 0; // along x
+    int rows = 0;    // along y
+    int cellStart[MAX_GRID_CELLS + 1];
+    int entries[BALL_CAPACITY];
+    
+    void init(float diameter);
+    void build(const BallPhysics& physics, int numBalls);
+    int cellOf(float x, float y);
+    // the active balls after ball that may touch it, in increasing order. Returns how many were written.
+    int candidates(const BallPhysics& physics, int ball, int* out);
+};
+
+// A discrete change in the motion of the balls, as predicted by the event-driven solver.
+struct PhysicsEvent
+{
+    enum Type {NONE, BALL_BALL, CUSHION_X, CUSHION_Y, POCKET, STOP};
+    Type type = NONE;
+    float time = 0.0f; // on the shot clock, like GameEvent::time.
+    int ball = -1;
+    int other = -1; // the second ball for BALL_BALL, the hole for POCKET.
+};
+
+// Something that happened during a shot that matters to the rules, see GameLogic::recordEvents.
+struct GameEvent
+{
+    enum Type {BALL_BALL, POCKET, FOUL, WINNER};
+    Type type;
+    float time; // seconds since the cue ball was struck.
+    int ball;   // the first ball for BALL_BALL, the winning player for WINNER.
+    int other;  // the second ball for BALL_BALL, the hole for POCKET.
+};
+
+// One ball within a GameState.
+struct BallState
+{
+    glm::quat rotation;
+    float x, y, vx, vy, radius, start;
+    int8_t inHole;
+    uint8_t flags;
+    enum Flags : uint8_t {ANIMATING_FALL = 1, HIDE = 2, AWAKE = 4};
+};
+static_assert(sizeof(BallState) <= 48, "a BallState should stay well within a cache line");
+
+// Snapshot of a game, see GameLogic::save(). It holds no pointers so it can be copied with memcpy,
+// and only the first numBalls balls mean anything. The settings such as the solver are not part of it.
+struct GameState
+{
+    int32_t numBalls;
+    float direction;
+    float chargeTime;
+    float physicsAccumulator;
+    float shotClock;
+    int8_t currentPlayer;
+    int8_t winner;
+    uint8_t p1Color;
+    uint8_t flags;
+    enum Flags : uint8_t {
+        AIMING = 1, CHARGING = 2, COLORS_CHOSEN = 4, SCORED_THIS_SHOT = 8,
+        FAULT_THIS_SHOT = 16, TOUCHED_A_BALL_THIS_SHOT = 32, FIRST_SHOT = 64, EVENTS_DIRTY = 128,
+    };
+    PhysicsEvent nextEvent; // so the event-driven solver carries on exactly where it was.
+    BallState balls[MAX_BALLS];
+};
+static_assert(std::is_trivially_copyable_v<GameState>, "GameState has to stay memcpy-able");
+
+class GameLogic;
+
+// see GameLogic.cpp, shared with ShotTimeline which rolls its keys forward the same way.
+glm::quat rolled(glm::quat rotation, glm::vec2 velocity, float radius, float distance);
+
+// When a rollout may stop before every ball rests, for simulations that only need to judge a shot.
+// All default to off. A shot cut short is finished as if the balls had stopped where they were,
+// with the balls already falling into a hole going in.
+struct StopConditions
+{
+    bool eightPocketed = false;
+    bool scratch = false;
+    bool illegalFirstContact = false;
+    float energyBelow = 0; // total kinetic energy of the balls on the table, per unit of mass.
+    std::function<bool(GameLogic&)> custom; // checked after every tick when set.
+};
+
 class GameLogic {
 public:
-    void init() {initBalls(); initHoles();};
-    Ball getBall(int index) {return balls[index];}
+    // numBalls other than NUM_BALLS sets up a variant table, see initBalls(). It is clamped to MAX_BALLS,
+    // which is NUM_BALLS unless built with a larger BILLIARDS_MAX_BALLS. The holes come first, the lattice keeps clear of them.
+    void init(int numBalls = NUM_BALLS) {initHoles(); initBalls(numBalls);};
+    Ball getBall(int index);
+    // save() and restore() copy the whole position and the rules state, for trying out shots and undoing them.
+    void save(GameState& state) const;
+    GameState save() const {GameState state; save(state); return state;}
+    void restore(const GameState& state);
     void updateGame(Input input);
     glm::mat4 computeStickWorldMatrix();
-    glm::mat4 pointerWorldMatrix();
-    int getCurrentPlayer() {return currentPlayer;}
-    Ball::BallType getTargetType() {
+    // a ghost ball at the given position, for the aim preview.
+    glm::mat4 pointerWorldMatrix(glm::vec2 position);
+    int getCurrentPlayer() const {return currentPlayer;}
+    Ball::BallType getTargetType() const {
         if(!colorsChosen) return Ball::CUE;
         if(currentPlayer == 0) return p1Color;
         else return (p1Color == Ball::FULL) ? Ball::STRIPE : Ball::FULL;
     }
-    int getWinner() {return winner;}
+    int getWinner() const {return winner;}
+    // how long fire has been held for the shot being aimed, 0 until it is.
+    float getChargeTime() const {return chargeTime;}
+    // the hole the ball went into, or -1 while it is on the table.
+    int getHoleIndex(int ball) {return balls[ball].inHole;}
+    glm::vec2 getHolePosition(int hole) const {return holes[hole].position;}
+    
+    // headless play, without going through updateGame frame by frame.
+    // strike() hits the cue ball as if fire had been held for charge seconds,
+    // simulateShot() then runs the physics clock until the balls rest, or one of the stop conditions holds,
+    // and scores the shot. It returns the number of ticks simulated, and gives up after maxTicks.
+    void strike(float direction, float charge);
+    int simulateShot(const StopConditions& stop = {}, int maxTicks = DEFAULT_PHYSICS_TICK_RATE * 600);
+    bool wasCutShort() {return cutShort;}
+    float kineticEnergy();
+    
+    // where a ball is and how fast it goes at the given shot clock time, in closed form from the last
+    // event that changed its motion, without stepping. Collisions after that event are not foreseen,
+    // so only times up to the present, or up to the next PhysicsEvent, are exact.
+    // The stepped solver keeps no segments and extrapolates from the current tick instead.
+    glm::vec2 positionAt(int ball, float time) const;
+    glm::vec2 velocityAt(int ball, float time) const;
+    float getShotClock() {return shotClock;}
+    
+    // while set, every shot keeps a log of its events, cleared when the next one is struck.
+    bool recordEvents = false;
+    // the rolling of the balls only shows on screen, headless simulations can skip it.
+    bool trackRotation = true;
+    const std::vector<GameEvent>& getEvents() {return events;}
+    
+    // STEPPED integrates every frame and resolves overlaps afterwards,
+    // EVENT_DRIVEN jumps from one predicted collision to the next.
+    enum Solver {STEPPED, EVENT_DRIVEN};
+    Solver solver = STEPPED;
+    
+    // physics runs on its own fixed clock, independently of the frame rate.
+    // After a hitch at most maxSubsteps ticks are simulated and the rest of the backlog is dropped.
+    int physicsTickRate = DEFAULT_PHYSICS_TICK_RATE;
+    int maxSubsteps = DEFAULT_MAX_SUBSTEPS;
+    
+    // how the stepped solver finds touching balls. Both resolve contacts in the same order,
+    // BRUTE_FORCE tests every pair and UNIFORM_GRID only neighbours, for tables with many balls.
+    enum BroadPhase {BRUTE_FORCE, UNIFORM_GRID};
+    BroadPhase broadPhase = BRUTE_FORCE;
+    int getNumBalls() {return numBalls;}
+    
+    // bit-reproducible play, for replays and lockstep sessions: the shot direction goes through
+    // portableSinCos() instead of libm, and updateGame() never drops physics ticks after a hitch,
+    // so a shot only depends on its strike and not on the frame timing. Contacts are always resolved
+    // in ball order and the physics is built without contraction or fast-math, see PortableMath.hpp.
+    bool deterministic = false;
+    // hash of the physical and rules state, without the rotation of the balls which only shows on screen.
+    // getShotChecksum() is the one taken when the last shot finished.
+    uint64_t checksum() const;
+    uint64_t getShotChecksum() {return shotChecksum;}
+    
+    // streams what happens during the shots to telemetry, which has to outlive the game. Copies of the game
+    // don't report, see TelemetryLink. nullptr stops reporting.
+    void setTelemetry(Telemetry* telemetry) {this->telemetry.target = telemetry;}
+    Telemetry* getTelemetry() const {return telemetry.target;}
     
     float direction = 90.0f;
     bool aiming = true;
-    Ball::BallType p1Color;
+    // only means anything once colorsChosen, CUE until then so that snapshots of a position are always the same.
+    Ball::BallType p1Color = Ball::CUE;
     bool colorsChosen = false;
     
     
 private:
-    Ball balls[NUM_BALLS];
+    Ball balls[MAX_BALLS];
+    BallPhysics physics;
+    ActiveSet awake;
+    UniformGrid grid;
+    int numBalls = NUM_BALLS;
     Hole holes[6];
     bool charging = false;
     float chargeTime = 0.0f;
@@ -87,20 +276,68 @@ private:
     bool touchedABallThisShot = false;
     int winner = -1;
     bool firstShot = true;
+    float physicsAccumulator = 0.0f;
+    float shotClock = 0.0f;
+    std::vector<GameEvent> events;
+    bool cutShort = false;
+    uint64_t shotChecksum = 0;
+    TelemetryLink telemetry;
     
+    void stepPhysics(float deltaT);
+    void finishShot();
+    bool shouldStop(const StopConditions& stop);
+    bool stopsByRules(const StopConditions& stop);
+    void cutShotShort();
+    void recordEvent(GameEvent::Type type, int ball, int other = -1);
+    void report(TelemetryEvent::Type type, int ball, int other, glm::vec2 where, float value);
+    void reportCushions(int block, unsigned alongX, unsigned alongY);
     void computeFrame(float deltaT);
     bool allBallsAreStill();
     void checkWhetherAnyBallsGoIn();
-    void handleScore(Ball&, Hole&);
-    void handleBallCollision(Ball& b1, Ball&b2);
+    void handleScore(int ball, int hole);
+    void handleBallCollision(int b1, int b2);
+    void handleContactRules(int b1, int b2);
     void handle8Pocket(int pocketingPlayer);
-    void applyAnimation(Ball& ball, float deltaT);
+    void applyAnimation(int ball, float deltaT);
     void checkCollisions();
+    void checkCollisionsBruteForce();
+    void checkCollisionsGrid();
+    unsigned overlapsInBlock(int ball, int block);
+    void rollBall(int ball, float distance);
+    
+    glm::vec2 positionOf(int ball) const {return glm::vec2(physics.x[ball], physics.y[ball]);}
+    glm::vec2 velocityOf(int ball) const {return glm::vec2(physics.vx[ball], physics.vy[ball]);}
+    void setPosition(int ball, glm::vec2 position) {physics.x[ball] = position.x; physics.y[ball] = position.y;}
+    // giving a ball speed wakes it up, stopping it is left to settle().
+    void setVelocity(int ball, glm::vec2 velocity) {
+        physics.vx[ball] = velocity.x;
+        physics.vy[ball] = velocity.y;
+        if (velocity != glm::vec2(0))
+            awake.wake(ball);
+    }
+    void settle(int ball);
+    
+    // event-driven solver, see EventSolver.cpp
+    PhysicsEvent nextEvent;
+    bool eventsDirty = true;
+    // how far the clock can go: deltaT, or less once MAX_EVENTS_PER_FRAME events have been resolved.
+    float advanceEvents(float deltaT);
+    PhysicsEvent predictNextEvent(float now);
+    void resolveEvent(const PhysicsEvent& event);
+    // motion segments: each ball moves along its own parabola from physics.start until the next event.
+    float segmentStart(int ball) const {return solver == EVENT_DRIVEN ? physics.start[ball] : shotClock;}
+    float segmentTime(int ball, float time) const;
+    float distanceAt(int ball, float time) const;
+    void materialize(int ball, float time);
     
-    void initBalls();
+    void initBalls(int count);
+    void initRack();
+    void initLattice();
     void initHoles();
     
     // testing
     void setRandomBallVelocities();
+    friend struct PhysicsBenchmark;
+    friend class TableBatch;
 };
 
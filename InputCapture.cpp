@@ -0,0 +1,129 @@
+#include "InputCapture.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iterator>
+
+static const char MAGIC[4] = {'B', 'I', 'N', 'P'};
+static const int HEADER_SIZE = 5;
+static const int FRAME_SIZE = 9 * 4 + 2;
+
+static void put8(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back(value);
+}
+
+static void putFloat(std::vector<uint8_t>& out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 4; i++)
+        out.push_back(uint8_t(bits >> (8 * i)));
+}
+
+static float getFloat(const uint8_t* in) {
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; i++)
+        bits |= uint32_t(in[i]) << (8 * i);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static double wallClock() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool InputCapture::startRecording(const std::string& path) {
+    file.open(path, std::ios::binary);
+    if (!file)
+        return false;
+    file.write(MAGIC, 4);
+    file.put(INPUT_CAPTURE_VERSION);
+    mode = RECORDING;
+    return true;
+}
+
+bool InputCapture::startPlayback(const std::string& path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (data.size() < HEADER_SIZE || memcmp(data.data(), MAGIC, 4) != 0 || data[4] != INPUT_CAPTURE_VERSION)
+        return false;
+
+    frames.clear();
+    // a session cut short by a crash may end in the middle of a frame, which is left out.
+    for (size_t at = HEADER_SIZE; at + FRAME_SIZE <= data.size(); at += FRAME_SIZE) {
+        const uint8_t* in = data.data() + at;
+        CapturedFrame frame;
+        frame.input.deltaT = getFloat(in);
+        frame.input.m = glm::vec3(getFloat(in + 4), getFloat(in + 8), getFloat(in + 12));
+        frame.input.r = glm::vec3(getFloat(in + 16), getFloat(in + 20), getFloat(in + 24));
+        frame.input.fire = in[28];
+        frame.aiStruck = in[29];
+        frame.aiShot = {getFloat(in + 30), getFloat(in + 34)};
+        frames.push_back(frame);
+    }
+    nextIndex = 0;
+    virtualTime = 0;
+    frameTimes.clear();
+    frameTimes.reserve(frames.size());
+    lastFrame = -1;
+    mode = PLAYING_BACK;
+    return true;
+}
+
+void InputCapture::recordFrame(const CapturedFrame& frame) {
+    if (mode != RECORDING)
+        return;
+    std::vector<uint8_t> out;
+    out.reserve(FRAME_SIZE);
+    putFloat(out, frame.input.deltaT);
+    for (int i = 0; i < 3; i++)
+        putFloat(out, frame.input.m[i]);
+    for (int i = 0; i < 3; i++)
+        putFloat(out, frame.input.r[i]);
+    put8(out, frame.input.fire);
+    put8(out, frame.aiStruck);
+    putFloat(out, frame.aiShot.direction);
+    putFloat(out, frame.aiShot.charge);
+    file.write((const char*)out.data(), out.size());
+    // a few dozen bytes a frame: flushing each one costs next to nothing and loses nothing on a crash.
+    file.flush();
+}
+
+bool InputCapture::nextFrame(CapturedFrame& frame) {
+    if (mode != PLAYING_BACK)
+        return false;
+    double now = wallClock();
+    if (lastFrame >= 0)
+        frameTimes.push_back(float((now - lastFrame) * 1000));
+    lastFrame = now;
+    if (nextIndex >= frames.size())
+        return false;
+    frame = frames[nextIndex++];
+    virtualTime += frame.input.deltaT;
+    return true;
+}
+
+void InputCapture::printFrameTimes(std::ostream& out) {
+    if (frameTimes.empty())
+        return;
+    std::vector<float> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {return sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))];};
+    double total = 0;
+    for (float time : sorted)
+        total += time;
+    out << std::fixed << std::setprecision(3);
+    out << sorted.size() << " frames, " << virtualTime << " s of session, frame times in ms: mean " << total / sorted.size()
+        << "  p50 " << percentile(0.5) << "  p90 " << percentile(0.9) << "  p99 " << percentile(0.99)
+        << "  max " << sorted.back() << "\n";
+}
+
+bool InputCapture::writeFrameTimes(const std::string& path) {
+    std::ofstream out(path);
+    for (float time : frameTimes)
+        out << time << "\n";
+    return (bool)out;
+}
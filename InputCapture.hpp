@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Input.hpp"
+#include "ShotEvaluator.hpp"
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+const int INPUT_CAPTURE_VERSION = 1;
+
+// One frame of an interactive session: the Input getSixAxis() read, and the shot the AI struck on it if any,
+// since the AI thinks against the wall clock and would not come up with the same shot twice.
+struct CapturedFrame
+{
+    Input input = {0.0f, glm::vec3(0), glm::vec3(0), false};
+    bool aiStruck = false;
+    Shot aiShot = {0.0f, 0.0f};
+};
+
+// Records the frames of a session to a file, or feeds them back in place of the devices and the clock.
+// Played back in deterministic mode, the session goes exactly as it did, whatever the frame rate,
+// so it can serve as a benchmark of the whole render and game loop: the wall clock time of every frame
+// played back is kept for printFrameTimes() and writeFrameTimes().
+//
+// The file is "BINP", the version, then one record per frame:
+// deltaT, m, r, fire, whether the AI struck, its direction and charge, all little endian.
+class InputCapture {
+public:
+    enum Mode {OFF, RECORDING, PLAYING_BACK};
+
+    // false if the file could not be created, or read.
+    bool startRecording(const std::string& path);
+    bool startPlayback(const std::string& path);
+    Mode getMode() {return mode;}
+
+    // flushed every frame, so a session that crashes is still captured up to there.
+    void recordFrame(const CapturedFrame& frame);
+    // the next recorded frame, false once every one has been played.
+    bool nextFrame(CapturedFrame& frame);
+    // the virtual clock: the sum of the deltaT played back so far.
+    double getTime() {return virtualTime;}
+
+    // count, mean and percentiles of the frame times of the playback, in milliseconds.
+    void printFrameTimes(std::ostream& out);
+    // one frame time in milliseconds per line, to compare distributions between builds.
+    bool writeFrameTimes(const std::string& path);
+
+private:
+    Mode mode = OFF;
+    std::ofstream file;
+    std::vector<CapturedFrame> frames;
+    size_t nextIndex = 0;
+    double virtualTime = 0;
+    std::vector<float> frameTimes;
+    double lastFrame = -1; // on the wall clock, in seconds.
+};
@@ -0,0 +1,163 @@
+#include "MatchRunner.hpp"
+#include "AIPlayer.hpp"
+#include "TableBatch.hpp"
+#include "json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+Shot RandomPolicy::chooseShot(const GameLogic&, std::mt19937& random) const {
+    std::uniform_real_distribution<float> anyDirection(0.0f, 360.0f);
+    std::uniform_real_distribution<float> anyCharge(AI_MIN_CHARGE, AI_MAX_CHARGE);
+    return {anyDirection(random), anyCharge(random)};
+}
+
+Shot GreedyPolicy::chooseShot(const GameLogic& table, std::mt19937& random) const {
+    // per thread rather than per call, so that a game doesn't allocate on every shot.
+    thread_local TableBatch batch;
+    thread_local std::vector<Shot> shots;
+    thread_local std::vector<ShotOutcome> outcomes;
+    static const StopConditions stop = rolloutStopConditions();
+
+    std::uniform_real_distribution<float> anyDirection(0.0f, 360.0f);
+    std::uniform_real_distribution<float> anyCharge(AI_MIN_CHARGE, AI_MAX_CHARGE);
+    shots.resize(candidates);
+    outcomes.resize(candidates);
+    for (auto& shot : shots) {
+        shot.direction = anyDirection(random);
+        shot.charge = anyCharge(random);
+    }
+    if (table.solver == GameLogic::STEPPED) {
+        batch.run(table, shots.data(), candidates, stop, outcomes.data());
+    } else {
+        for (int i = 0; i < candidates; i++)
+            outcomes[i] = evaluateShot(table, shots[i], stop);
+    }
+
+    int best = 0;
+    float bestScore = 0;
+    for (int i = 0; i < candidates; i++) {
+        float score = scoreOutcome(outcomes[i], table.getCurrentPlayer(), table.getTargetType());
+        if (i == 0 || score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
+    }
+    return shots[best];
+}
+
+MatchRunner::MatchRunner(const ShotPolicy& first, const ShotPolicy& second, int numThreads) : pool(numThreads) {
+    policies[0] = &first;
+    policies[1] = &second;
+}
+
+TournamentSummary MatchRunner::run(int numGames, uint64_t seed) {
+    this->numGames = numGames;
+    this->seed = seed;
+    results.assign(std::max(0, numGames), MatchResult());
+    nextGame = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    int numSlots = std::min(numGames, pool.size() * GAMES_IN_FLIGHT_PER_THREAD);
+    while ((int)slots.size() < numSlots)
+        slots.push_back(std::make_unique<Slot>());
+    for (int i = 0; i < numSlots; i++) {
+        Slot* slot = slots[i].get();
+        if (startGame(*slot))
+            pool.submit([this, slot] {playShot(*slot);});
+    }
+    pool.wait();
+
+    TournamentSummary summary;
+    for (int p = 0; p < 2; p++)
+        summary.players[p] = policies[p]->name();
+    summary.games = numGames;
+    summary.threads = pool.size();
+    for (auto& result : results) {
+        if (result.winner == -1)
+            summary.unfinished++;
+        else
+            summary.wins[result.winner]++;
+        summary.shots += result.shots;
+        for (int p = 0; p < 2; p++) {
+            summary.fouls[p] += result.fouls[p];
+            summary.pocketed[p] += result.pocketed[p];
+        }
+    }
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+// sets the slot up for the next game nobody has started yet, false once there are none left.
+bool MatchRunner::startGame(Slot& slot) {
+    slot.index = nextGame++;
+    if (slot.index >= numGames)
+        return false;
+    std::seed_seq sequence{uint32_t(seed), uint32_t(seed >> 32), uint32_t(slot.index)};
+    slot.random.seed(sequence);
+    slot.result = MatchResult();
+    // init() only racks the balls, the rules state of the previous game has to go as well.
+    slot.game = GameLogic();
+    slot.game.init();
+    slot.game.deterministic = true;
+    slot.game.recordEvents = true;
+    slot.game.trackRotation = false;
+    if (!replayDirectory.empty())
+        slot.replay.start(slot.game);
+    return true;
+}
+
+void MatchRunner::playShot(Slot& slot) {
+    GameLogic& game = slot.game;
+    // the first policy breaks in even games, the second one in odd games.
+    int swap = slot.index % 2;
+    int policy = game.getCurrentPlayer() ^ swap;
+    Shot shot = policies[policy]->chooseShot(game, slot.random);
+    if (!replayDirectory.empty())
+        slot.replay.recordShot(game, shot);
+    game.strike(shot.direction, shot.charge);
+    game.simulateShot();
+
+    MatchResult& result = slot.result;
+    result.shots++;
+    for (auto& event : game.getEvents()) {
+        if (event.type == GameEvent::FOUL)
+            result.fouls[policy]++;
+        if (event.type == GameEvent::POCKET && event.ball != 0 && event.ball != 8)
+            result.pocketed[policy]++;
+    }
+
+    if (game.getWinner() == -1 && result.shots < maxShotsPerGame) {
+        pool.submit([this, &slot] {playShot(slot);});
+        return;
+    }
+    if (game.getWinner() != -1)
+        result.winner = game.getWinner() ^ swap;
+    results[slot.index] = result;
+    if (!replayDirectory.empty())
+        slot.replay.write(replayDirectory + "/game-" + std::to_string(slot.index) + ".replay");
+    if (startGame(slot))
+        pool.submit([this, &slot] {playShot(slot);});
+}
+
+void TournamentSummary::write(const std::string& path) const {
+    nlohmann::json json;
+    json["games"] = games;
+    json["unfinished"] = unfinished;
+    json["threads"] = threads;
+    json["seconds"] = seconds;
+    json["gamesPerSecond"] = seconds > 0 ? games / seconds : 0;
+    json["shotsPerGame"] = games > 0 ? double(shots) / games : 0;
+    json["players"] = nlohmann::json::array();
+    for (int p = 0; p < 2; p++) {
+        json["players"].push_back({
+            {"policy", players[p]},
+            {"wins", wins[p]},
+            {"winRate", games > 0 ? double(wins[p]) / games : 0},
+            {"foulsPerGame", games > 0 ? double(fouls[p]) / games : 0},
+            {"pocketedPerGame", games > 0 ? double(pocketed[p]) / games : 0},
+        });
+    }
+    std::ofstream file(path);
+    file << json.dump(2) << "\n";
+}
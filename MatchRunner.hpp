@@ -0,0 +1,108 @@
+#pragma once
+
+#include "GameLogic.hpp"
+#include "Replay.hpp"
+#include "ShotEvaluator.hpp"
+#include "WorkStealingPool.hpp"
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+const int DEFAULT_MAX_SHOTS_PER_GAME = 300; // a game still going after that many shots counts as unfinished.
+const int DEFAULT_GREEDY_CANDIDATES = 32;
+const int GAMES_IN_FLIGHT_PER_THREAD = 2;
+
+// Decides the shots of one side in a bot match. A single policy plays in every game running at once,
+// so it keeps no state between shots, and draws its randomness from the game it is asked about.
+class ShotPolicy {
+public:
+    virtual ~ShotPolicy() = default;
+    virtual std::string name() const = 0;
+    virtual Shot chooseShot(const GameLogic& table, std::mt19937& random) const = 0;
+};
+
+// any direction, any charge an AIPlayer would consider.
+class RandomPolicy : public ShotPolicy {
+public:
+    std::string name() const override {return "random";}
+    Shot chooseShot(const GameLogic& table, std::mt19937& random) const override;
+};
+
+// plays out a handful of random shots and takes the one scoreOutcome() likes best,
+// a single batch of an AIPlayer search without the refinement.
+class GreedyPolicy : public ShotPolicy {
+public:
+    explicit GreedyPolicy(int candidates = DEFAULT_GREEDY_CANDIDATES) : candidates(candidates) {}
+    std::string name() const override {return "greedy" + std::to_string(candidates);}
+    Shot chooseShot(const GameLogic& table, std::mt19937& random) const override;
+
+private:
+    int candidates;
+};
+
+// How one game went. The indices are the two policies, not the seats, which swap from game to game.
+struct MatchResult
+{
+    int winner = -1; // the policy that won, -1 if the game ran out of shots.
+    int shots = 0;
+    int fouls[2] = {};
+    int pocketed[2] = {}; // object balls sunk on the policy's own shots.
+};
+
+struct TournamentSummary
+{
+    std::string players[2];
+    int games = 0;
+    int wins[2] = {};
+    int unfinished = 0;
+    long long shots = 0;
+    long long fouls[2] = {};
+    long long pocketed[2] = {};
+    double seconds = 0;
+    int threads = 0;
+
+    // as JSON, with the rates worked out.
+    void write(const std::string& path) const;
+};
+
+// Plays whole games of 8-ball between two policies, many of them at once.
+// Every shot is one task of a WorkStealingPool, which submits the next shot of its game when done:
+// the game stays on its thread while that one is busy, and idle threads steal games from the others.
+// Only GAMES_IN_FLIGHT_PER_THREAD games per thread are under way at a time, and their tables are reused
+// for the following games, so memory does not grow with the number of games.
+// Game i only depends on the seed and i, in deterministic mode, so the results don't depend on the threads.
+class MatchRunner {
+public:
+    // 0 uses one thread per hardware thread.
+    MatchRunner(const ShotPolicy& first, const ShotPolicy& second, int numThreads = 0);
+
+    int maxShotsPerGame = DEFAULT_MAX_SHOTS_PER_GAME;
+    // when set, game i is recorded to replayDirectory/game-i.replay.
+    std::string replayDirectory;
+
+    TournamentSummary run(int numGames, uint64_t seed);
+    // of every game of the last run, in order.
+    const std::vector<MatchResult>& getResults() {return results;}
+
+private:
+    // a game under way, reused for the next one once it is over.
+    struct Slot {
+        GameLogic game;
+        std::mt19937 random;
+        int index = -1;
+        MatchResult result;
+        ReplayWriter replay;
+    };
+    const ShotPolicy* policies[2];
+    WorkStealingPool pool;
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<MatchResult> results;
+    std::atomic<int> nextGame{0};
+    int numGames = 0;
+    uint64_t seed = 0;
+
+    bool startGame(Slot& slot);
+    void playShot(Slot& slot);
+};
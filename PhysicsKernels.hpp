@@ -0,0 +1,54 @@
+#pragma once
+
+#include "GameLogic.hpp"
+#include "Simd.hpp"
+
+/*
+    The per-ball math of GameLogic::computeFrame, written for SIMD_WIDTH balls at once.
+    Lanes outside the active mask are left untouched instead of being skipped with a branch.
+ */
+
+// slows the balls down by deltaV along their velocity, stopping them rather than reversing them.
+inline void frictionKernel(vfloat& vx, vfloat& vy, vmask active, vfloat deltaV) {
+    using namespace simd;
+    vfloat speed = sqrt(add(mul(vx, vx), mul(vy, vy)));
+    vmask moving = maskAnd(active, gt(speed, set1(0)));
+    // the division is garbage for balls at rest, but those lanes are not moving and keep their velocity.
+    vfloat scale = max(sub(set1(1), div(deltaV, speed)), set1(0));
+    vx = select(moving, mul(vx, scale), vx);
+    vy = select(moving, mul(vy, scale), vy);
+}
+
+inline void displacementKernel(vfloat& x, vfloat& y, vfloat vx, vfloat vy, vmask active, vfloat deltaT) {
+    using namespace simd;
+    x = select(active, add(x, mul(deltaT, vx)), x);
+    y = select(active, add(y, mul(deltaT, vy)), y);
+}
+
+// pushes balls back onto the table and mirrors their velocity when they reach a cushion.
+inline void cushionKernel(vfloat& x, vfloat& y, vfloat& vx, vfloat& vy, vfloat radius, vmask active) {
+    using namespace simd;
+    vmask hit = maskAnd(active, ge(add(y, radius), set1(TABLE_RIGHT_EDGE)));
+    y = select(hit, sub(set1(TABLE_RIGHT_EDGE), radius), y);
+    vy = select(hit, neg(vy), vy);
+
+    hit = maskAnd(active, le(sub(y, radius), set1(TABLE_LEFT_EDGE)));
+    y = select(hit, add(set1(TABLE_LEFT_EDGE), radius), y);
+    vy = select(hit, neg(vy), vy);
+
+    hit = maskAnd(active, ge(add(x, radius), set1(TABLE_TOP_EDGE)));
+    x = select(hit, sub(set1(TABLE_TOP_EDGE), radius), x);
+    vx = select(hit, neg(vx), vx);
+
+    hit = maskAnd(active, le(sub(x, radius), set1(TABLE_BOTTOM_EDGE)));
+    x = select(hit, add(set1(TABLE_BOTTOM_EDGE), radius), x);
+    vx = select(hit, neg(vx), vx);
+}
+
+// lanes where the two circles are closer than reach.
+inline vmask withinKernel(vfloat x1, vfloat y1, vfloat x2, vfloat y2, vfloat reach) {
+    using namespace simd;
+    vfloat dx = sub(x2, x1);
+    vfloat dy = sub(y2, y1);
+    return lt(add(mul(dx, dx), mul(dy, dy)), mul(reach, reach));
+}
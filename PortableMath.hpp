@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cmath>
+
+/*
+    Floating point rules for the physics translation units, so that a shot gives the same bits
+    on every compiler and machine. Only include it from the .cpp files of the simulation, and before anything else:
+    the pragma below only covers the code after it, and that includes glm and the inline functions of GameLogic.hpp.
+    +, -, *, / and sqrt are correctly rounded by IEEE 754, which leaves three ways to diverge:
+    -ffast-math reassociating sums, a * b + c contracted into a fused multiply-add on some machines
+    but not others, and libm's transcendental functions, which differ between platforms.
+ */
+#if defined(__FAST_MATH__)
+#error "the physics has to be built without -ffast-math, its results would depend on the compiler"
+#endif
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+// GCC ignores the pragma above, and inline functions compiled elsewhere can still be the copy the linker keeps,
+// so both builds also pass -ffp-contract=off to everything: PUBLIC on billiards_sim in CMakeLists.txt,
+// and in OTHER_CPLUSPLUSFLAGS of the Billiards target in Project.xcodeproj. A build that leaves it out isn't deterministic.
+
+// sine and cosine of an angle in degrees, from + and * only. Accurate to well within a float.
+inline void portableSinCos(float degrees, float& sine, float& cosine) {
+    // reduce to [-45, 45] degrees around the nearest multiple of 90, which is exact.
+    double d = std::fmod(double(degrees), 360.0);
+    double quadrant = std::floor(d / 90.0 + 0.5);
+    double x = (d - quadrant * 90.0) * (3.14159265358979323846 / 180.0);
+    double x2 = x * x;
+    // Taylor series up to x^13 and x^14, the first term left out is below 1e-13 at 45 degrees.
+    double s = x * (1 + x2 * (-1.0 / 6 + x2 * (1.0 / 120 + x2 * (-1.0 / 5040 + x2 * (1.0 / 362880
+        + x2 * (-1.0 / 39916800 + x2 * (1.0 / 6227020800.0)))))));
+    double c = 1 + x2 * (-1.0 / 2 + x2 * (1.0 / 24 + x2 * (-1.0 / 720 + x2 * (1.0 / 40320
+        + x2 * (-1.0 / 3628800 + x2 * (1.0 / 479001600 + x2 * (-1.0 / 87178291200.0)))))));
+    switch (((int)quadrant % 4 + 4) % 4) {
+        case 0: sine = s; cosine = c; break;
+        case 1: sine = c; cosine = -s; break;
+        case 2: sine = -s; cosine = -c; break;
+        default: sine = -c; cosine = s; break;
+    }
+}
@@ -0,0 +1,292 @@
+#include "Replay.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+// the only definitions of the deflater and the inflater, Starter.hpp includes sinfl.h for its declarations.
+#define SDEFL_IMPLEMENTATION
+#include "sdefl.h"
+#define SINFL_IMPLEMENTATION
+#include "sinfl.h"
+
+static const char MAGIC[4] = {'B', 'R', 'E', 'P'};
+static const int HEADER_SIZE = 28;
+static const int INDEX_ENTRY_SIZE = 12;
+// next to the BallState flags, for a ball whose velocity is not all zero bits.
+static const uint8_t MOVING = 0x80;
+
+static void put8(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back(value);
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        out.push_back(uint8_t(value >> (8 * i)));
+}
+
+static uint32_t bitsOf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float floatOf(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void putFloat(std::vector<uint8_t>& out, float value) {
+    put32(out, bitsOf(value));
+}
+
+// reads past the end give zeros and mark the reader as failed, so a truncated chunk is caught once at the end.
+struct ByteReader {
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+    bool failed = false;
+
+    uint8_t get8() {
+        if (position + 1 > size) {
+            failed = true;
+            return 0;
+        }
+        return data[position++];
+    }
+    uint32_t get32() {
+        if (position + 4 > size) {
+            failed = true;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++)
+            value |= uint32_t(data[position + i]) << (8 * i);
+        position += 4;
+        return value;
+    }
+    float getFloat() {return floatOf(get32());}
+};
+
+// only what a table at rest needs, velocities and segments are left out for the balls that have none.
+// A ball that went into a hole keeps the velocity it fell in with, and a stopped one may have -0.
+static void encodeKeyframe(std::vector<uint8_t>& out, const GameState& state) {
+    putFloat(out, state.direction);
+    // where the last shot stopped the clock, which checksum() covers.
+    putFloat(out, state.shotClock);
+    put8(out, state.currentPlayer);
+    put8(out, state.winner);
+    put8(out, state.p1Color);
+    put8(out, state.flags);
+    for (int i = 0; i < state.numBalls; i++) {
+        const BallState& ball = state.balls[i];
+        bool moving = (bitsOf(ball.vx) | bitsOf(ball.vy) | bitsOf(ball.start)) != 0;
+        put8(out, ball.flags | (moving ? MOVING : 0));
+        put8(out, ball.inHole);
+        putFloat(out, ball.x);
+        putFloat(out, ball.y);
+        putFloat(out, ball.radius);
+        // a ball in a hole is never drawn, its rotation doesn't matter.
+        if (ball.inHole == -1) {
+            putFloat(out, ball.rotation.w);
+            putFloat(out, ball.rotation.x);
+            putFloat(out, ball.rotation.y);
+            putFloat(out, ball.rotation.z);
+        }
+        if (moving) {
+            putFloat(out, ball.vx);
+            putFloat(out, ball.vy);
+            putFloat(out, ball.start);
+        }
+    }
+}
+
+static void decodeKeyframe(ByteReader& in, GameState& state, int numBalls) {
+    state = GameState();
+    state.numBalls = numBalls;
+    state.direction = in.getFloat();
+    state.shotClock = in.getFloat();
+    state.currentPlayer = (int8_t)in.get8();
+    state.winner = (int8_t)in.get8();
+    state.p1Color = in.get8();
+    // the shot is struck by strike(), not by letting go of fire.
+    state.flags = (in.get8() & ~GameState::CHARGING) | GameState::EVENTS_DIRTY;
+    for (int i = 0; i < numBalls; i++) {
+        BallState& ball = state.balls[i];
+        uint8_t flags = in.get8();
+        ball.flags = flags & ~MOVING;
+        ball.inHole = (int8_t)in.get8();
+        ball.x = in.getFloat();
+        ball.y = in.getFloat();
+        ball.radius = in.getFloat();
+        ball.rotation = glm::quat(1, 0, 0, 0);
+        if (ball.inHole == -1) {
+            ball.rotation.w = in.getFloat();
+            ball.rotation.x = in.getFloat();
+            ball.rotation.y = in.getFloat();
+            ball.rotation.z = in.getFloat();
+        }
+        if (flags & MOVING) {
+            ball.vx = in.getFloat();
+            ball.vy = in.getFloat();
+            ball.start = in.getFloat();
+        }
+    }
+}
+
+void ReplayWriter::start(const GameLogic& game) {
+    solver = game.solver;
+    broadPhase = game.broadPhase;
+    numBalls = game.save().numBalls;
+    physicsTickRate = game.physicsTickRate;
+    numShots = 0;
+    chunks.clear();
+    current.clear();
+}
+
+void ReplayWriter::recordShot(const GameState& table, Shot shot) {
+    if (numShots % keyframeInterval == 0) {
+        encodeKeyframe(current, table);
+        previous = {table.direction, 0.0f};
+    }
+    put32(current, bitsOf(shot.direction) ^ bitsOf(previous.direction));
+    put32(current, bitsOf(shot.charge) ^ bitsOf(previous.charge));
+    previous = shot;
+    numShots++;
+    if (numShots % keyframeInterval == 0)
+        closeChunk();
+}
+
+void ReplayWriter::closeChunk() {
+    if (current.empty())
+        return;
+    // the deflater keeps its hash tables inline, too large for the stack.
+    auto deflater = std::make_unique<sdefl>();
+    Chunk chunk;
+    chunk.rawSize = (uint32_t)current.size();
+    chunk.data.resize(sdefl_bound((int)current.size()));
+    int size = sdeflate(deflater.get(), chunk.data.data(), current.data(), (int)current.size(), SDEFL_LVL_MAX);
+    chunk.data.resize(size);
+    chunks.push_back(std::move(chunk));
+    current.clear();
+}
+
+bool ReplayWriter::write(const std::string& path) {
+    closeChunk();
+    std::vector<uint8_t> out;
+    out.insert(out.end(), MAGIC, MAGIC + 4);
+    put8(out, REPLAY_VERSION);
+    put8(out, solver);
+    put8(out, broadPhase);
+    put8(out, 0); // reserved
+    put32(out, numBalls);
+    put32(out, physicsTickRate);
+    put32(out, keyframeInterval);
+    put32(out, numShots);
+    put32(out, (uint32_t)chunks.size());
+    uint32_t offset = HEADER_SIZE + INDEX_ENTRY_SIZE * (uint32_t)chunks.size();
+    for (auto& chunk : chunks) {
+        put32(out, offset);
+        put32(out, (uint32_t)chunk.data.size());
+        put32(out, chunk.rawSize);
+        offset += (uint32_t)chunk.data.size();
+    }
+    for (auto& chunk : chunks)
+        out.insert(out.end(), chunk.data.begin(), chunk.data.end());
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)out.data(), out.size());
+    return (bool)file;
+}
+
+bool ReplayReader::open(const std::string& path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+    file.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    decodedChunk = -1;
+    index.clear();
+    if (file.size() < HEADER_SIZE || memcmp(file.data(), MAGIC, 4) != 0 || file[4] != REPLAY_VERSION)
+        return false;
+
+    ByteReader header{file.data() + 5, HEADER_SIZE - 5};
+    solver = header.get8();
+    broadPhase = header.get8();
+    header.get8();
+    numBalls = (int)header.get32();
+    physicsTickRate = (int)header.get32();
+    keyframeInterval = (int)header.get32();
+    numShots = (int)header.get32();
+    uint32_t numChunks = header.get32();
+    if (numBalls < 1 || numBalls > MAX_BALLS || keyframeInterval < 1 || physicsTickRate < 1 || numShots < 0
+        || numChunks != uint32_t((numShots + keyframeInterval - 1) / keyframeInterval)
+        || file.size() < HEADER_SIZE + uint64_t(INDEX_ENTRY_SIZE) * numChunks)
+        return false;
+
+    ByteReader entries{file.data() + HEADER_SIZE, INDEX_ENTRY_SIZE * size_t(numChunks)};
+    for (uint32_t i = 0; i < numChunks; i++) {
+        IndexEntry entry;
+        entry.offset = entries.get32();
+        entry.size = entries.get32();
+        entry.rawSize = entries.get32();
+        if (uint64_t(entry.offset) + entry.size > file.size())
+            return false;
+        index.push_back(entry);
+    }
+    return true;
+}
+
+bool ReplayReader::decode(int chunk) {
+    if (chunk == decodedChunk)
+        return true;
+    const IndexEntry& entry = index[chunk];
+    std::vector<uint8_t> raw(entry.rawSize);
+    int size = sinflate(raw.data(), (int)raw.size(), file.data() + entry.offset, (int)entry.size);
+    if (size != (int)entry.rawSize)
+        return false;
+
+    ByteReader in{raw.data(), raw.size()};
+    decodeKeyframe(in, keyframe, numBalls);
+    int count = std::min(keyframeInterval, numShots - chunk * keyframeInterval);
+    shots.resize(count);
+    Shot previous = {keyframe.direction, 0.0f};
+    for (auto& shot : shots) {
+        shot.direction = floatOf(in.get32() ^ bitsOf(previous.direction));
+        shot.charge = floatOf(in.get32() ^ bitsOf(previous.charge));
+        previous = shot;
+    }
+    if (in.failed)
+        return false;
+    decodedChunk = chunk;
+    return true;
+}
+
+Shot ReplayReader::getShot(int shot) {
+    if (shot < 0 || shot >= numShots || !decode(shot / keyframeInterval))
+        return {0.0f, 0.0f};
+    return shots[shot % keyframeInterval];
+}
+
+bool ReplayReader::seek(GameLogic& game, int shot) {
+    shot = std::clamp(shot, 0, numShots);
+    int chunk = std::min(shot / keyframeInterval, (int)index.size() - 1);
+    if (chunk < 0 || !decode(chunk))
+        return false;
+    game.solver = (GameLogic::Solver)solver;
+    game.broadPhase = (GameLogic::BroadPhase)broadPhase;
+    game.physicsTickRate = physicsTickRate;
+    game.deterministic = true;
+    game.restore(keyframe);
+    // the shots on the way were played already, they are not news to the telemetry.
+    Telemetry* telemetry = game.getTelemetry();
+    game.setTelemetry(nullptr);
+    for (int i = chunk * keyframeInterval; i < shot; i++) {
+        Shot next = shots[i - chunk * keyframeInterval];
+        game.strike(next.direction, next.charge);
+        game.simulateShot();
+    }
+    game.setTelemetry(telemetry);
+    return true;
+}
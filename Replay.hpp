@@ -0,0 +1,97 @@
+#pragma once
+
+#include "GameLogic.hpp"
+#include "ShotEvaluator.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const int REPLAY_KEYFRAME_INTERVAL = 16; // shots per keyframe, seeking replays at most this many less one.
+const int REPLAY_VERSION = 2; // 2 widened the number of balls and added the shot clock to the keyframes.
+
+/*
+    A replay file holds the shots of a game played in deterministic mode, from which every table in between
+    can be simulated again, and a keyframe of the table every REPLAY_KEYFRAME_INTERVAL shots so that
+    seeking doesn't have to start from the break.
+
+    header    "BREP", version, solver, broad phase, a zero byte, balls, tick rate, keyframe interval, shots, chunks
+    index     per chunk: offset in the file, compressed size, raw size
+    chunks    each deflated on its own with sdefl: the keyframe the chunk starts from, then its shots
+
+    A keyframe only holds what a table at rest has: where the balls are, the rules state and the shot clock,
+    so that a table sought to has the checksum() it had when it was played.
+    A shot is its direction and charge, each XORed with the previous one in the chunk,
+    so that the bits they share come out as zero bytes for the deflater.
+    All numbers are little endian.
+ */
+
+// Records a game shot by shot. Chunks are compressed as soon as they are full.
+class ReplayWriter {
+public:
+    explicit ReplayWriter(int keyframeInterval = REPLAY_KEYFRAME_INTERVAL) : keyframeInterval(keyframeInterval) {}
+
+    // forgets the previous recording and takes the settings of game, which has to play deterministically.
+    void start(const GameLogic& game);
+    // table is the position the shot is played from, while aiming.
+    void recordShot(const GameState& table, Shot shot);
+    void recordShot(const GameLogic& table, Shot shot) {recordShot(table.save(), shot);}
+    int getNumShots() {return numShots;}
+
+    // false if the file could not be written.
+    bool write(const std::string& path);
+
+private:
+    int keyframeInterval;
+    uint8_t solver = GameLogic::STEPPED;
+    uint8_t broadPhase = GameLogic::BRUTE_FORCE;
+    int numBalls = NUM_BALLS;
+    int physicsTickRate = DEFAULT_PHYSICS_TICK_RATE;
+    int numShots = 0;
+
+    struct Chunk {
+        std::vector<uint8_t> data;
+        uint32_t rawSize;
+    };
+    std::vector<Chunk> chunks;
+    std::vector<uint8_t> current; // the chunk being recorded, not compressed yet.
+    Shot previous;
+
+    void closeChunk();
+};
+
+// Reads a whole replay into memory, and finds any shot of it through the chunk index.
+// Only the chunk of the last shot asked for is kept decompressed.
+class ReplayReader {
+public:
+    // false if the file is missing or not a replay this version understands.
+    bool open(const std::string& path);
+    int getNumShots() {return numShots;}
+    Shot getShot(int shot);
+
+    // sets game up with the recorded settings and the table the shot is played from, at most
+    // keyframeInterval - 1 shots away from a keyframe. getNumShots() gives the table after the last shot.
+    // false if the replay has no shots or its chunk is damaged, game is left as it was then.
+    bool seek(GameLogic& game, int shot);
+
+private:
+    std::vector<uint8_t> file;
+    uint8_t solver = GameLogic::STEPPED;
+    uint8_t broadPhase = GameLogic::BRUTE_FORCE;
+    int numBalls = 0;
+    int physicsTickRate = DEFAULT_PHYSICS_TICK_RATE;
+    int keyframeInterval = REPLAY_KEYFRAME_INTERVAL;
+    int numShots = 0;
+
+    struct IndexEntry {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t rawSize;
+    };
+    std::vector<IndexEntry> index;
+
+    int decodedChunk = -1;
+    GameState keyframe;
+    std::vector<Shot> shots;
+
+    bool decode(int chunk);
+};
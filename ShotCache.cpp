@@ -0,0 +1,141 @@
+#include "ShotCache.hpp"
+#include <algorithm>
+#include <cmath>
+
+// splitmix64's finalizer, so that nearby quantized values end up far apart.
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t combine(uint64_t hash, uint64_t value) {
+    return mix(hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2)));
+}
+
+// murmur3's finalizer, for the second hash: another seed and another mix, so that it doesn't collide along with the first.
+static uint64_t mixCheck(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+static ShotKey combine(ShotKey key, uint64_t value) {
+    return {combine(key.hash, value), mixCheck(key.check ^ (value * 0xd6e8feb86659fd93ull + (key.check << 7)))};
+}
+
+static uint64_t quantize(float value, float step) {
+    return (uint64_t)(int64_t)std::llround(value / step);
+}
+
+ShotCache::ShotCache(size_t capacity) {
+    shardCapacity = std::max<size_t>(1, capacity / SHOT_CACHE_SHARDS);
+}
+
+ShotKey ShotCache::tableKey(const GameLogic& table, const StopConditions& stop) {
+    GameState state;
+    table.save(state);
+    
+    ShotKey hash = {mix(state.numBalls), mixCheck(state.numBalls ^ 0x6a09e667f3bcc909ull)};
+    uint64_t inHoleMask = 0;
+    for (int i = 0; i < state.numBalls; i++) {
+        const BallState& ball = state.balls[i];
+        if (ball.inHole != -1) {
+            inHoleMask |= uint64_t(1) << (i % 64);
+        } else {
+            hash = combine(hash, quantize(ball.x, CACHE_POSITION_STEP));
+            hash = combine(hash, quantize(ball.y, CACHE_POSITION_STEP));
+            // balls are normally at rest when a shot is taken, but not necessarily.
+            hash = combine(hash, quantize(ball.vx, CACHE_POSITION_STEP));
+            hash = combine(hash, quantize(ball.vy, CACHE_POSITION_STEP));
+        }
+        if (i % 64 == 63) {
+            hash = combine(hash, inHoleMask);
+            inHoleMask = 0;
+        }
+    }
+    hash = combine(hash, inHoleMask);
+    hash = combine(hash, state.currentPlayer);
+    hash = combine(hash, (state.flags & GameState::COLORS_CHOSEN) ? 1 + state.p1Color : 0);
+    hash = combine(hash, state.winner + 1);
+    
+    hash = combine(hash, table.solver);
+    hash = combine(hash, table.physicsTickRate);
+    // an outcome is only reused for a table simulated exactly the same way.
+    hash = combine(hash, table.broadPhase);
+    hash = combine(hash, table.deterministic);
+    hash = combine(hash, stop.eightPocketed | stop.scratch << 1 | stop.illegalFirstContact << 2);
+    hash = combine(hash, quantize(stop.energyBelow, CACHE_POSITION_STEP));
+    return hash;
+}
+
+ShotKey ShotCache::shotKey(ShotKey tableKey, Shot shot) {
+    float direction = std::fmod(shot.direction, 360.0f);
+    if (direction < 0)
+        direction += 360.0f;
+    ShotKey hash = combine(tableKey, quantize(direction, CACHE_DIRECTION_STEP));
+    return combine(hash, quantize(shot.charge, CACHE_CHARGE_STEP));
+}
+
+bool ShotCache::find(ShotKey key, ShotOutcome& outcome) {
+    Shard& shard = shardOf(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found = shard.index.find(key.hash);
+        if (found != shard.index.end() && shard.entries[found->second].key == key) {
+            Entry& entry = shard.entries[found->second];
+            entry.referenced = true;
+            outcome = entry.outcome;
+            hitCount++;
+            return true;
+        }
+    }
+    missCount++;
+    return false;
+}
+
+void ShotCache::insert(ShotKey key, const ShotOutcome& outcome) {
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key.hash);
+    if (found != shard.index.end()) {
+        // on a collision of the first hash the newer table takes the slot.
+        Entry& entry = shard.entries[found->second];
+        entry.key = key;
+        entry.outcome = outcome;
+        return;
+    }
+    if (shard.entries.size() < shardCapacity) {
+        shard.index[key.hash] = shard.entries.size();
+        shard.entries.push_back({key, false, outcome});
+        return;
+    }
+    
+    // second chance: entries used since the hand last came by are spared once.
+    while (shard.entries[shard.hand].referenced) {
+        shard.entries[shard.hand].referenced = false;
+        shard.hand = (shard.hand + 1) % shard.entries.size();
+    }
+    Entry& victim = shard.entries[shard.hand];
+    shard.index.erase(victim.key.hash);
+    victim = {key, false, outcome};
+    shard.index[key.hash] = shard.hand;
+    shard.hand = (shard.hand + 1) % shard.entries.size();
+}
+
+void ShotCache::clear() {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.clear();
+        shard.index.clear();
+        shard.hand = 0;
+    }
+    hitCount = 0;
+    missCount = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "GameLogic.hpp"
+#include "ShotEvaluator.hpp"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+const size_t DEFAULT_SHOT_CACHE_CAPACITY = 1 << 16; // outcomes.
+const int SHOT_CACHE_SHARDS = 16;
+// positions and shots closer than this are considered the same.
+const float CACHE_POSITION_STEP = 0.001f;  // logical units.
+const float CACHE_DIRECTION_STEP = 0.001f; // degrees.
+const float CACHE_CHARGE_STEP = 0.0001f;   // seconds.
+
+// Two independent 64-bit hashes of the quantized table and shot. The first picks the shard and the slot,
+// the second is kept in the entry and compared on lookup, so that a collision of the first one
+// is a miss instead of the outcome of another table.
+struct ShotKey
+{
+    uint64_t hash;
+    uint64_t check;
+    bool operator==(const ShotKey& other) const {return hash == other.hash && check == other.check;}
+};
+
+// Remembers the outcome of shots already simulated, keyed on hashes of the quantized table and shot.
+// Safe to share between threads: the entries are split over shards with a lock each,
+// and every shard evicts with the clock algorithm once it is full.
+class ShotCache {
+public:
+    explicit ShotCache(size_t capacity = DEFAULT_SHOT_CACHE_CAPACITY);
+    
+    // everything about the table that decides how a shot plays out: the quantized positions,
+    // the balls in the holes, whose turn it is, the colors, and how the shot is simulated:
+    // the solver, the tick rate, the broad phase and the deterministic mode.
+    // A custom stop condition can't be told apart from another one, so it is not part of the key
+    // and ShotEvaluator doesn't use the cache for shots that have one.
+    static ShotKey tableKey(const GameLogic& table, const StopConditions& stop);
+    static ShotKey shotKey(ShotKey tableKey, Shot shot);
+    
+    bool find(ShotKey key, ShotOutcome& outcome);
+    void insert(ShotKey key, const ShotOutcome& outcome);
+    void clear();
+    
+    uint64_t hits() {return hitCount;}
+    uint64_t misses() {return missCount;}
+    
+private:
+    struct Entry {
+        ShotKey key;
+        bool referenced; // since the clock hand last passed it.
+        ShotOutcome outcome;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Entry> entries;
+        std::unordered_map<uint64_t, size_t> index; // key.hash to position in entries.
+        size_t hand = 0;
+    };
+    
+    size_t shardCapacity;
+    Shard shards[SHOT_CACHE_SHARDS];
+    std::atomic<uint64_t> hitCount{0};
+    std::atomic<uint64_t> missCount{0};
+    
+    Shard& shardOf(ShotKey key) {return shards[key.hash % SHOT_CACHE_SHARDS];}
+};
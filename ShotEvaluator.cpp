@@ -0,0 +1,92 @@
+#include "ShotEvaluator.hpp"
+#include "ShotCache.hpp"
+#include "TableBatch.hpp"
+#include <algorithm>
+
+ShotOutcome evaluateShot(const GameLogic& table, Shot shot, const StopConditions& stop) {
+    GameLogic game = table;
+    game.recordEvents = true;
+    game.trackRotation = false;
+    game.strike(shot.direction, shot.charge);
+    
+    int ticks = game.simulateShot(stop);
+    return shotOutcome(game, shot, ticks);
+}
+
+ShotOutcome shotOutcome(GameLogic& game, Shot shot, int ticks) {
+    ShotOutcome outcome;
+    outcome.shot = shot;
+    outcome.ticks = ticks;
+    outcome.cutShort = game.wasCutShort();
+    for (auto& event : game.getEvents()) {
+        if (event.type == GameEvent::POCKET)
+            outcome.pocketed.push_back(event.ball);
+        else if (event.type == GameEvent::FOUL)
+            outcome.foul = true;
+    }
+    for (int ball : outcome.pocketed) {
+        if (ball == 8)
+            outcome.eightSunk = true;
+    }
+    outcome.winner = game.getWinner();
+    outcome.nextPlayer = game.getCurrentPlayer();
+    outcome.positions.resize(game.getNumBalls());
+    for (int i = 0; i < game.getNumBalls(); i++)
+        outcome.positions[i] = game.getBall(i).position;
+    return outcome;
+}
+
+std::vector<ShotOutcome> ShotEvaluator::evaluate(const GameLogic& table, const std::vector<Shot>& shots) {
+    std::vector<ShotOutcome> outcomes(shots.size());
+    // the shots still to simulate, those not in the cache.
+    std::vector<int> pending;
+    std::vector<ShotKey> keys;
+    // a custom stop condition isn't part of the key, shots watched by one are always simulated.
+    bool cached = cache && !stopConditions.custom;
+    if (cached) {
+        ShotKey tableKey = ShotCache::tableKey(table, stopConditions);
+        for (int i = 0; i < (int)shots.size(); i++) {
+            ShotKey key = ShotCache::shotKey(tableKey, shots[i]);
+            if (cache->find(key, outcomes[i])) {
+                outcomes[i].shot = shots[i];
+            } else {
+                pending.push_back(i);
+                keys.push_back(key);
+            }
+        }
+    } else {
+        for (int i = 0; i < (int)shots.size(); i++)
+            pending.push_back(i);
+    }
+    
+    if (batched && table.solver == GameLogic::STEPPED) {
+        // one contiguous slice of shots per thread, streamed through the lanes of a TableBatch.
+        std::vector<Shot> pendingShots(pending.size());
+        for (size_t k = 0; k < pending.size(); k++)
+            pendingShots[k] = shots[pending[k]];
+        std::vector<ShotOutcome> pendingOutcomes(pending.size());
+        // the slice size first, then as many slices as it takes, so that none of them starts past the end.
+        int numPending = (int)pending.size();
+        int maxSlices = std::min(pool.size(), (numPending + SIMD_WIDTH - 1) / SIMD_WIDTH);
+        int sliceSize = maxSlices > 0 ? (numPending + maxSlices - 1) / maxSlices : 0;
+        int numSlices = sliceSize > 0 ? (numPending + sliceSize - 1) / sliceSize : 0;
+        pool.parallelFor(numSlices, [&](int slice) {
+            int first = slice * sliceSize;
+            int count = std::min(sliceSize, numPending - first);
+            TableBatch batch;
+            batch.run(table, pendingShots.data() + first, count, stopConditions, pendingOutcomes.data() + first);
+        });
+        for (size_t k = 0; k < pending.size(); k++)
+            outcomes[pending[k]] = std::move(pendingOutcomes[k]);
+    } else {
+        pool.parallelFor((int)pending.size(), [&](int k) {
+            outcomes[pending[k]] = evaluateShot(table, shots[pending[k]], stopConditions);
+        });
+    }
+    
+    if (cached) {
+        for (size_t k = 0; k < pending.size(); k++)
+            cache->insert(keys[k], outcomes[pending[k]]);
+    }
+    return outcomes;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "GameLogic.hpp"
+#include "ThreadPool.hpp"
+#include <vector>
+
+class ShotCache;
+
+struct Shot
+{
+    float direction; // in degrees, like GameLogic::direction.
+    float charge;    // seconds fire would have been held for.
+};
+
+// How a shot played out, once every ball came to rest.
+struct ShotOutcome
+{
+    Shot shot;
+    std::vector<int> pocketed; // in the order they went in, the cue ball included.
+    bool foul = false;
+    bool eightSunk = false;
+    int winner = -1;
+    int nextPlayer = 0;
+    int ticks = 0;
+    bool cutShort = false; // by one of the stop conditions, the positions are then where the balls were.
+    std::vector<glm::vec2> positions; // of every ball, where it ended up.
+};
+
+// plays the shot on a copy of the table, leaving the table itself untouched.
+ShotOutcome evaluateShot(const GameLogic& table, Shot shot, const StopConditions& stop = {});
+// sums up a shot that was struck on game and simulated for the given number of ticks.
+ShotOutcome shotOutcome(GameLogic& game, Shot shot, int ticks);
+
+// Tries many shots from the same position at once, one copy of the table per shot.
+class ShotEvaluator {
+public:
+    // 0 uses one thread per hardware thread.
+    explicit ShotEvaluator(int numThreads = 0) : pool(numThreads) {}
+    
+    // the outcomes are in the same order as the shots.
+    std::vector<ShotOutcome> evaluate(const GameLogic& table, const std::vector<Shot>& shots);
+    int numThreads() {return pool.size();}
+    
+    // applied to every shot, searches usually don't need to see the balls come to rest.
+    StopConditions stopConditions;
+    // when set, shots already in the cache are not simulated again, and new outcomes are added to it.
+    // Left alone while stopConditions.custom is set, which the key can't capture.
+    ShotCache* cache = nullptr;
+    // tables with the stepped solver play SIMD_WIDTH shots per thread at once, see TableBatch.
+    // The outcomes are the same either way.
+    bool batched = true;
+    
+private:
+    ThreadPool pool;
+};
@@ -0,0 +1,108 @@
+#include "ShotTimeline.hpp"
+#include <algorithm>
+
+// how long the ball has moved since the key, it stands still once it stopped.
+static float movingTime(const TimelineKey& key, float time) {
+    float t = std::max(0.0f, time - key.time);
+    if (key.deceleration > 0)
+        t = std::min(t, glm::length(key.velocity) / key.deceleration);
+    return t;
+}
+
+static float distanceAt(const TimelineKey& key, float time) {
+    float t = movingTime(key, time);
+    return glm::length(key.velocity) * t - key.deceleration * t * t / 2;
+}
+
+glm::vec2 ShotTimeline::positionAt(const TimelineKey& key, float time) {
+    if (key.velocity == glm::vec2(0))
+        return key.position;
+    return key.position + glm::normalize(key.velocity) * distanceAt(key, time);
+}
+
+TimelineKey ShotTimeline::keyOf(GameLogic& game, int index) {
+    Ball ball = game.getBall(index);
+    TimelineKey key;
+    key.time = game.getShotClock();
+    key.position = ball.position;
+    key.velocity = ball.inHole == -1 ? ball.velocity : glm::vec2(0);
+    key.deceleration = FRICTION_FACTOR;
+    key.rotation = ball.rotation;
+    key.inHole = ball.inHole;
+    key.animatingFall = ball.animatingFall;
+    key.hide = ball.hide;
+    // a falling ball heads for the middle of its hole as fast as it went in, and no slower than
+    // MIN_FALL_SPEED, like GameLogic::applyAnimation() moves it.
+    if (ball.animatingFall) {
+        glm::vec2 hole = game.getHolePosition(ball.inHole);
+        if (hole != ball.position)
+            key.velocity = glm::normalize(hole - ball.position) * std::max(glm::length(ball.velocity), MIN_FALL_SPEED);
+        key.deceleration = 0;
+    }
+    return key;
+}
+
+void ShotTimeline::addKeysWhereOff(GameLogic& game) {
+    float now = game.getShotClock();
+    for (int i = 0; i < numBalls; i++) {
+        const TimelineKey& last = keys[i].back();
+        Ball ball = game.getBall(i);
+        bool sameState = ball.inHole == last.inHole && ball.animatingFall == last.animatingFall && ball.hide == last.hide;
+        if (sameState && glm::distance(positionAt(last, now), ball.position) <= TIMELINE_TOLERANCE)
+            continue;
+        keys[i].push_back(keyOf(game, i));
+    }
+}
+
+void ShotTimeline::build(const GameLogic& struck) {
+    GameLogic game = struck;
+    // this copy plays the shot for real, it reports in place of struck.
+    game.setTelemetry(struck.getTelemetry());
+    numBalls = game.getNumBalls();
+    radius.resize(numBalls);
+    keys.assign(numBalls, {});
+    cursors.assign(numBalls, 0);
+    for (int i = 0; i < numBalls; i++) {
+        radius[i] = game.getBall(i).radius;
+        keys[i].push_back(keyOf(game, i));
+    }
+    StopConditions everyTick;
+    everyTick.custom = [this](GameLogic& game) {
+        addKeysWhereOff(game);
+        return false;
+    };
+    game.simulateShot(everyTick);
+    // the last tick, and the cue ball going back on the spot after a foul.
+    addKeysWhereOff(game);
+    duration = game.getShotClock();
+    game.save(finalState);
+}
+
+int ShotTimeline::getNumKeys() {
+    int count = 0;
+    for (auto& ballKeys : keys)
+        count += (int)ballKeys.size();
+    return count;
+}
+
+Ball ShotTimeline::ballAt(int index, float time) {
+    const std::vector<TimelineKey>& ballKeys = keys[index];
+    int& cursor = cursors[index];
+    if (cursor > 0 && ballKeys[cursor].time > time)
+        cursor = 0;
+    while (cursor + 1 < (int)ballKeys.size() && ballKeys[cursor + 1].time <= time)
+        cursor++;
+    const TimelineKey& key = ballKeys[cursor];
+
+    Ball ball;
+    ball.id = index;
+    ball.radius = radius[index];
+    ball.position = positionAt(key, time);
+    if (key.velocity != glm::vec2(0))
+        ball.velocity = glm::normalize(key.velocity) * (glm::length(key.velocity) - key.deceleration * movingTime(key, time));
+    ball.rotation = rolled(key.rotation, key.velocity, ball.radius, distanceAt(key, time));
+    ball.inHole = key.inHole;
+    ball.animatingFall = key.animatingFall;
+    ball.hide = key.hide;
+    return ball;
+}
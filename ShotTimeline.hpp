@@ -0,0 +1,49 @@
+#pragma once
+
+#include "GameLogic.hpp"
+#include <vector>
+
+const float TIMELINE_TOLERANCE = 0.002f; // how far a ball may be drawn off its simulated path, a ball is 1 across.
+
+// How one ball moves from the time of the key until the next key of the same ball.
+struct TimelineKey
+{
+    float time; // on the shot clock.
+    glm::vec2 position;
+    glm::vec2 velocity;
+    float deceleration; // FRICTION_FACTOR while rolling, 0 while falling into a hole at a steady speed.
+    glm::quat rotation;
+    int8_t inHole;
+    bool animatingFall;
+    bool hide;
+};
+
+// A shot simulated to the end as soon as it is struck, kept as a few keys per ball, so that the render loop
+// only has to work out where the balls are at the time it draws instead of stepping the physics.
+// Between two keys a ball follows the closed-form motion of the event-driven solver. A new key is taken
+// whenever the simulation strays more than TIMELINE_TOLERANCE from it: at the collisions, and every so often
+// while the stepped solver's integration drifts. Any time of the shot can be looked at, in any order.
+class ShotTimeline {
+public:
+    // simulates the shot just struck on game, which is left as it is. The telemetry of game gets the shot.
+    void build(const GameLogic& game);
+    float getDuration() {return duration;}
+    int getNumKeys();
+    // the ball at the given time of the shot. Each ball remembers the key it was last looked at,
+    // so that playing the shot forwards only ever steps to the next one.
+    Ball ballAt(int ball, float time);
+    // the table once the balls came to rest and the shot was scored, for the game to carry on from.
+    const GameState& getFinalState() {return finalState;}
+
+private:
+    int numBalls = 0;
+    std::vector<float> radius;
+    std::vector<std::vector<TimelineKey>> keys;
+    std::vector<int> cursors;
+    float duration = 0;
+    GameState finalState;
+
+    TimelineKey keyOf(GameLogic& game, int ball);
+    void addKeysWhereOff(GameLogic& game);
+    glm::vec2 positionAt(const TimelineKey& key, float time);
+};
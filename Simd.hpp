@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+/*
+    Thin wrapper over the widest SIMD instruction set enabled at compile time.
+    vfloat holds SIMD_WIDTH floats, vmask the result of a lane-wise comparison.
+    Define BILLIARDS_NO_SIMD to force the scalar fallback, where both are plain values.
+ */
+#if !defined(BILLIARDS_NO_SIMD) && defined(__AVX512F__)
+#include <immintrin.h>
+#define SIMD_AVX512
+const int SIMD_WIDTH = 16;
+typedef __m512 vfloat;
+typedef __mmask16 vmask;
+#elif !defined(BILLIARDS_NO_SIMD) && defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_AVX
+const int SIMD_WIDTH = 8;
+typedef __m256 vfloat;
+typedef __m256 vmask;
+#elif !defined(BILLIARDS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define SIMD_SSE
+const int SIMD_WIDTH = 4;
+typedef __m128 vfloat;
+typedef __m128 vmask;
+#elif !defined(BILLIARDS_NO_SIMD) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD_NEON
+const int SIMD_WIDTH = 4;
+typedef float32x4_t vfloat;
+typedef uint32x4_t vmask;
+#else
+#define SIMD_SCALAR
+const int SIMD_WIDTH = 1;
+typedef float vfloat;
+typedef bool vmask;
+#endif
+
+// rounds a number of lanes up to whole vectors.
+constexpr int simdPadded(int count) {
+    return (count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+}
+
+namespace simd {
+
+#if defined(SIMD_AVX512)
+inline vfloat load(const float* p) {return _mm512_load_ps(p);}
+inline void store(float* p, vfloat a) {_mm512_store_ps(p, a);}
+inline vmask loadMask(const int32_t* p) {return _mm512_cmpneq_epi32_mask(_mm512_load_si512(p), _mm512_setzero_si512());}
+inline void storeMask(int32_t* p, vmask m) {_mm512_store_si512(p, _mm512_maskz_mov_epi32(m, _mm512_set1_epi32(-1)));}
+inline vfloat set1(float a) {return _mm512_set1_ps(a);}
+inline vfloat add(vfloat a, vfloat b) {return _mm512_add_ps(a, b);}
+inline vfloat sub(vfloat a, vfloat b) {return _mm512_sub_ps(a, b);}
+inline vfloat mul(vfloat a, vfloat b) {return _mm512_mul_ps(a, b);}
+inline vfloat div(vfloat a, vfloat b) {return _mm512_div_ps(a, b);}
+inline vfloat sqrt(vfloat a) {return _mm512_sqrt_ps(a);}
+inline vfloat min(vfloat a, vfloat b) {return _mm512_min_ps(a, b);}
+inline vfloat max(vfloat a, vfloat b) {return _mm512_max_ps(a, b);}
+inline vfloat neg(vfloat a) {return _mm512_sub_ps(_mm512_setzero_ps(), a);}
+inline vmask lt(vfloat a, vfloat b) {return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);}
+inline vmask le(vfloat a, vfloat b) {return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);}
+inline vmask gt(vfloat a, vfloat b) {return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);}
+inline vmask ge(vfloat a, vfloat b) {return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ);}
+inline vmask neq(vfloat a, vfloat b) {return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ);}
+inline vmask maskAnd(vmask a, vmask b) {return a & b;}
+inline vmask maskOr(vmask a, vmask b) {return a | b;}
+inline vmask maskAndNot(vmask a, vmask b) {return a & ~b;}
+inline vfloat select(vmask m, vfloat a, vfloat b) {return _mm512_mask_blend_ps(m, b, a);}
+inline unsigned bits(vmask m) {return m;}
+#elif defined(SIMD_AVX)
+inline vfloat load(const float* p) {return _mm256_load_ps(p);}
+inline void store(float* p, vfloat a) {_mm256_store_ps(p, a);}
+inline vmask loadMask(const int32_t* p) {return _mm256_castsi256_ps(_mm256_load_si256((const __m256i*)p));}
+inline void storeMask(int32_t* p, vmask m) {_mm256_store_si256((__m256i*)p, _mm256_castps_si256(m));}
+inline vfloat set1(float a) {return _mm256_set1_ps(a);}
+inline vfloat add(vfloat a, vfloat b) {return _mm256_add_ps(a, b);}
+inline vfloat sub(vfloat a, vfloat b) {return _mm256_sub_ps(a, b);}
+inline vfloat mul(vfloat a, vfloat b) {return _mm256_mul_ps(a, b);}
+inline vfloat div(vfloat a, vfloat b) {return _mm256_div_ps(a, b);}
+inline vfloat sqrt(vfloat a) {return _mm256_sqrt_ps(a);}
+inline vfloat min(vfloat a, vfloat b) {return _mm256_min_ps(a, b);}
+inline vfloat max(vfloat a, vfloat b) {return _mm256_max_ps(a, b);}
+inline vfloat neg(vfloat a) {return _mm256_sub_ps(_mm256_setzero_ps(), a);}
+inline vmask lt(vfloat a, vfloat b) {return _mm256_cmp_ps(a, b, _CMP_LT_OQ);}
+inline vmask le(vfloat a, vfloat b) {return _mm256_cmp_ps(a, b, _CMP_LE_OQ);}
+inline vmask gt(vfloat a, vfloat b) {return _mm256_cmp_ps(a, b, _CMP_GT_OQ);}
+inline vmask ge(vfloat a, vfloat b) {return _mm256_cmp_ps(a, b, _CMP_GE_OQ);}
+inline vmask neq(vfloat a, vfloat b) {return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ);}
+inline vmask maskAnd(vmask a, vmask b) {return _mm256_and_ps(a, b);}
+inline vmask maskOr(vmask a, vmask b) {return _mm256_or_ps(a, b);}
+inline vmask maskAndNot(vmask a, vmask b) {return _mm256_andnot_ps(b, a);}
+inline vfloat select(vmask m, vfloat a, vfloat b) {return _mm256_blendv_ps(b, a, m);}
+inline unsigned bits(vmask m) {return _mm256_movemask_ps(m);}
+#elif defined(SIMD_SSE)
+inline vfloat load(const float* p) {return _mm_load_ps(p);}
+inline void store(float* p, vfloat a) {_mm_store_ps(p, a);}
+inline vmask loadMask(const int32_t* p) {return _mm_castsi128_ps(_mm_load_si128((const __m128i*)p));}
+inline void storeMask(int32_t* p, vmask m) {_mm_store_si128((__m128i*)p, _mm_castps_si128(m));}
+inline vfloat set1(float a) {return _mm_set1_ps(a);}
+inline vfloat add(vfloat a, vfloat b) {return _mm_add_ps(a, b);}
+inline vfloat sub(vfloat a, vfloat b) {return _mm_sub_ps(a, b);}
+inline vfloat mul(vfloat a, vfloat b) {return _mm_mul_ps(a, b);}
+inline vfloat div(vfloat a, vfloat b) {return _mm_div_ps(a, b);}
+inline vfloat sqrt(vfloat a) {return _mm_sqrt_ps(a);}
+inline vfloat min(vfloat a, vfloat b) {return _mm_min_ps(a, b);}
+inline vfloat max(vfloat a, vfloat b) {return _mm_max_ps(a, b);}
+inline vfloat neg(vfloat a) {return _mm_sub_ps(_mm_setzero_ps(), a);}
+inline vmask lt(vfloat a, vfloat b) {return _mm_cmplt_ps(a, b);}
+inline vmask le(vfloat a, vfloat b) {return _mm_cmple_ps(a, b);}
+inline vmask gt(vfloat a, vfloat b) {return _mm_cmpgt_ps(a, b);}
+inline vmask ge(vfloat a, vfloat b) {return _mm_cmpge_ps(a, b);}
+inline vmask neq(vfloat a, vfloat b) {return _mm_cmpneq_ps(a, b);}
+inline vmask maskAnd(vmask a, vmask b) {return _mm_and_ps(a, b);}
+inline vmask maskOr(vmask a, vmask b) {return _mm_or_ps(a, b);}
+inline vmask maskAndNot(vmask a, vmask b) {return _mm_andnot_ps(b, a);}
+inline vfloat select(vmask m, vfloat a, vfloat b) {return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));}
+inline unsigned bits(vmask m) {return _mm_movemask_ps(m);}
+#elif defined(SIMD_NEON)
+inline vfloat load(const float* p) {return vld1q_f32(p);}
+inline void store(float* p, vfloat a) {vst1q_f32(p, a);}
+inline vmask loadMask(const int32_t* p) {return vreinterpretq_u32_s32(vld1q_s32(p));}
+inline void storeMask(int32_t* p, vmask m) {vst1q_s32(p, vreinterpretq_s32_u32(m));}
+inline vfloat set1(float a) {return vdupq_n_f32(a);}
+inline vfloat add(vfloat a, vfloat b) {return vaddq_f32(a, b);}
+inline vfloat sub(vfloat a, vfloat b) {return vsubq_f32(a, b);}
+inline vfloat mul(vfloat a, vfloat b) {return vmulq_f32(a, b);}
+inline vfloat div(vfloat a, vfloat b) {return vdivq_f32(a, b);}
+inline vfloat sqrt(vfloat a) {return vsqrtq_f32(a);}
+inline vfloat min(vfloat a, vfloat b) {return vminq_f32(a, b);}
+inline vfloat max(vfloat a, vfloat b) {return vmaxq_f32(a, b);}
+inline vfloat neg(vfloat a) {return vnegq_f32(a);}
+inline vmask lt(vfloat a, vfloat b) {return vcltq_f32(a, b);}
+inline vmask le(vfloat a, vfloat b) {return vcleq_f32(a, b);}
+inline vmask gt(vfloat a, vfloat b) {return vcgtq_f32(a, b);}
+inline vmask ge(vfloat a, vfloat b) {return vcgeq_f32(a, b);}
+inline vmask neq(vfloat a, vfloat b) {return vmvnq_u32(vceqq_f32(a, b));}
+inline vmask maskAnd(vmask a, vmask b) {return vandq_u32(a, b);}
+inline vmask maskOr(vmask a, vmask b) {return vorrq_u32(a, b);}
+inline vmask maskAndNot(vmask a, vmask b) {return vbicq_u32(a, b);}
+inline vfloat select(vmask m, vfloat a, vfloat b) {return vbslq_f32(m, a, b);}
+inline unsigned bits(vmask m) {
+    const uint32x4_t weights = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(m, weights));
+}
+#else
+inline vfloat load(const float* p) {return *p;}
+inline void store(float* p, vfloat a) {*p = a;}
+inline vmask loadMask(const int32_t* p) {return *p != 0;}
+inline void storeMask(int32_t* p, vmask m) {*p = m ? -1 : 0;}
+inline vfloat set1(float a) {return a;}
+inline vfloat add(vfloat a, vfloat b) {return a + b;}
+inline vfloat sub(vfloat a, vfloat b) {return a - b;}
+inline vfloat mul(vfloat a, vfloat b) {return a * b;}
+inline vfloat div(vfloat a, vfloat b) {return a / b;}
+inline vfloat sqrt(vfloat a) {return std::sqrt(a);}
+inline vfloat min(vfloat a, vfloat b) {return a < b ? a : b;}
+inline vfloat max(vfloat a, vfloat b) {return a > b ? a : b;}
+inline vfloat neg(vfloat a) {return -a;}
+inline vmask lt(vfloat a, vfloat b) {return a < b;}
+inline vmask le(vfloat a, vfloat b) {return a <= b;}
+inline vmask gt(vfloat a, vfloat b) {return a > b;}
+inline vmask ge(vfloat a, vfloat b) {return a >= b;}
+inline vmask neq(vfloat a, vfloat b) {return a != b;}
+inline vmask maskAnd(vmask a, vmask b) {return a && b;}
+inline vmask maskOr(vmask a, vmask b) {return a || b;}
+inline vmask maskAndNot(vmask a, vmask b) {return a && !b;}
+inline vfloat select(vmask m, vfloat a, vfloat b) {return m ? a : b;}
+inline unsigned bits(vmask m) {return m ? 1 : 0;}
+#endif
+
+} // namespace simd
@@ -0,0 +1,197 @@
+// Headless driver for the simulation library: plays one shot on a fresh table
+// and prints what happened, or times it when asked to repeat it.
+// --batch evaluates N shots spread over a full turn instead, on --threads threads.
+// With --cache the batch is evaluated twice through a ShotCache, the second time from the cache.
+// --one-per-thread plays a single table per thread instead of one per SIMD lane, see TableBatch.
+// --deterministic plays in GameLogic's deterministic mode, whose checksum should match on every machine.
+//
+//     simulate <direction> <charge> [--event-driven] [--grid] [--balls N] [--tick-rate HZ] [--repeat N]
+//                                   [--batch N] [--threads N] [--cache] [--one-per-thread] [--deterministic]
+//
+// direction is in degrees like GameLogic::direction, charge is how long fire would have been held, in seconds.
+// --balls goes up to MAX_BALLS, the 16 balls of a rack unless built with -DBILLIARDS_MAX_BALLS=N.
+
+#include "GameLogic.hpp"
+#include "ShotCache.hpp"
+#include "ShotEvaluator.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+struct Options {
+    float direction = 90.0f;
+    float charge = 1.0f;
+    bool eventDriven = false;
+    bool grid = false;
+    int numBalls = NUM_BALLS;
+    int tickRate = DEFAULT_PHYSICS_TICK_RATE;
+    int repeat = 0;
+    int batch = 0;
+    int threads = 0;
+    bool cache = false;
+    bool onePerThread = false;
+    bool deterministic = false;
+};
+
+static void usage() {
+    std::cerr << "usage: simulate <direction> <charge> [--event-driven] [--grid] [--balls N] [--tick-rate HZ] [--repeat N]\n"
+                 "                                  [--batch N] [--threads N] [--cache] [--one-per-thread] [--deterministic]\n"
+                 "--balls N is at most " << MAX_BALLS << ", rebuild with -DBILLIARDS_MAX_BALLS=N for larger tables\n";
+    exit(1);
+}
+
+static Options parseOptions(int argc, char** argv) {
+    Options options;
+    if (argc < 3)
+        usage();
+    options.direction = atof(argv[1]);
+    options.charge = atof(argv[2]);
+    for (int i = 3; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--event-driven") == 0)
+            options.eventDriven = true;
+        else if (strcmp(argv[i], "--grid") == 0)
+            options.grid = true;
+        else if (strcmp(argv[i], "--balls") == 0 && hasValue)
+            options.numBalls = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tick-rate") == 0 && hasValue)
+            options.tickRate = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--repeat") == 0 && hasValue)
+            options.repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--batch") == 0 && hasValue)
+            options.batch = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+            options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache") == 0)
+            options.cache = true;
+        else if (strcmp(argv[i], "--one-per-thread") == 0)
+            options.onePerThread = true;
+        else if (strcmp(argv[i], "--deterministic") == 0)
+            options.deterministic = true;
+        else
+            usage();
+    }
+    if (options.numBalls > MAX_BALLS)
+        std::cerr << "only " << MAX_BALLS << " balls supported, rebuild with a larger BILLIARDS_MAX_BALLS\n";
+    return options;
+}
+
+static void setUp(GameLogic& game, const Options& options) {
+    game.init(options.numBalls);
+    game.solver = options.eventDriven ? GameLogic::EVENT_DRIVEN : GameLogic::STEPPED;
+    game.broadPhase = options.grid ? GameLogic::UNIFORM_GRID : GameLogic::BRUTE_FORCE;
+    game.physicsTickRate = options.tickRate;
+    game.deterministic = options.deterministic;
+}
+
+static void printEvent(const GameEvent& event) {
+    std::cout << "  " << std::setw(8) << event.time << "  ";
+    switch (event.type) {
+        case GameEvent::BALL_BALL:
+            std::cout << "ball " << event.ball << " hits ball " << event.other;
+            break;
+        case GameEvent::POCKET:
+            std::cout << "ball " << event.ball << " goes into hole " << event.other;
+            break;
+        case GameEvent::FOUL:
+            std::cout << "foul, cue ball back on the spot";
+            break;
+        case GameEvent::WINNER:
+            std::cout << "player " << event.ball + 1 << " wins";
+            break;
+    }
+    std::cout << "\n";
+}
+
+static void printShot(const Options& options) {
+    GameLogic game;
+    setUp(game, options);
+    game.recordEvents = true;
+    game.strike(options.direction, options.charge);
+    int ticks = game.simulateShot();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "shot: direction " << options.direction << " charge " << options.charge
+              << ", " << ticks << " ticks (" << float(ticks) / options.tickRate << " s)\n";
+    std::cout << "events:\n";
+    for (auto& event : game.getEvents())
+        printEvent(event);
+    std::cout << "table:\n";
+    for (int i = 0; i < game.getNumBalls(); i++) {
+        Ball ball = game.getBall(i);
+        std::cout << "  ball " << std::setw(4) << i;
+        if (game.getHoleIndex(i) != -1)
+            std::cout << "  in hole " << game.getHoleIndex(i) << "\n";
+        else
+            std::cout << "  x " << std::setw(8) << ball.position.x << "  y " << std::setw(8) << ball.position.y << "\n";
+    }
+    if (game.getWinner() != -1)
+        std::cout << "winner: player " << game.getWinner() + 1 << "\n";
+    else
+        std::cout << "next: player " << game.getCurrentPlayer() + 1 << "\n";
+    std::cout << "checksum: " << std::hex << std::setw(16) << std::setfill('0') << game.getShotChecksum() << "\n";
+}
+
+static void timeShot(const Options& options) {
+    long long totalTicks = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.repeat; i++) {
+        GameLogic game;
+        setUp(game, options);
+        game.strike(options.direction, options.charge);
+        totalTicks += game.simulateShot();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << options.repeat << " shots, " << totalTicks << " ticks in " << seconds << " s\n";
+    std::cout << std::setprecision(1) << options.repeat / seconds << " shots/s, " << seconds * 1e9 / totalTicks << " ns/tick\n";
+}
+
+static void evaluateBatch(const Options& options) {
+    GameLogic table;
+    setUp(table, options);
+    std::vector<Shot> shots(options.batch);
+    for (int i = 0; i < options.batch; i++)
+        shots[i] = {options.direction + 360.0f * i / options.batch, options.charge};
+    
+    ShotEvaluator evaluator(options.threads);
+    evaluator.batched = !options.onePerThread;
+    ShotCache cache;
+    if (options.cache) {
+        evaluator.cache = &cache;
+        evaluator.evaluate(table, shots);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ShotOutcome> outcomes = evaluator.evaluate(table, shots);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    int scoring = 0, fouls = 0, eights = 0;
+    for (auto& outcome : outcomes) {
+        if (!outcome.pocketed.empty())
+            scoring++;
+        if (outcome.foul)
+            fouls++;
+        if (outcome.eightSunk)
+            eights++;
+    }
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << options.batch << " shots on " << evaluator.numThreads() << " threads in " << seconds << " s\n";
+    std::cout << std::setprecision(1) << options.batch / seconds << " shots/s\n";
+    std::cout << scoring << " pocket a ball, " << fouls << " are fouls, " << eights << " sink the 8\n";
+    if (options.cache)
+        std::cout << "cache: " << cache.hits() << " hits, " << cache.misses() << " misses\n";
+}
+
+int main(int argc, char** argv) {
+    Options options = parseOptions(argc, argv);
+    if (options.batch > 0)
+        evaluateBatch(options);
+    else if (options.repeat > 0)
+        timeShot(options);
+    else
+        printShot(options);
+    return 0;
+}
@@ -7,10 +7,14 @@
 #include <cstring>
 #include <optional>
 #include <set>
+#include <map>
 #include <cstdint>
 #include <algorithm>
 #include <fstream>
 #include <array>
+#include <unordered_map>
+#include <filesystem>
+#include <iterator>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
@@ -39,9 +43,20 @@
 
 #include "plusaes.hpp"
 
-#define SINFL_IMPLEMENTATION
+// implemented in Replay.cpp, which also needs the inflater.
 #include "sinfl.h"
 
+#include <atomic>
+#include <exception>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
@@ -160,6 +175,48 @@ std::vector<char> readFile(const std::string& filename) {
 	return buffer;
 }
 
+// A whole file mapped read-only into memory, or read into it where there is no mmap.
+class MappedFile {
+	const uint8_t *bytes = nullptr;
+	size_t length = 0;
+	std::vector<char> copy;
+
+	public:
+	// false if the file can't be opened, or is empty.
+	bool open(const std::string &filename) {
+#ifndef _WIN32
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if(fd < 0) return false;
+		struct stat st;
+		if(fstat(fd, &st) == 0 && st.st_size > 0) {
+			void *mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(mapping != MAP_FAILED) {
+				bytes = (const uint8_t *)mapping;
+				length = (size_t)st.st_size;
+			}
+		}
+		::close(fd);
+#else
+		std::ifstream file(filename, std::ios::binary);
+		if(!file) return false;
+		copy.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		bytes = (const uint8_t *)copy.data();
+		length = copy.size();
+#endif
+		return length > 0;
+	}
+	const uint8_t *data() const {return bytes;}
+	size_t size() const {return length;}
+	MappedFile() = default;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile() {
+#ifndef _WIN32
+		if(bytes) munmap((void *)bytes, length);
+#endif
+	}
+};
+
 class BaseProject;
 
 struct VertexBindingDescriptorElement {
@@ -206,6 +263,37 @@ struct VertexDescriptor {
 
 enum ModelType {OBJ, GLTF, MGCG};
 
+// OBJ models are parsed once and then loaded from a binary cache next to them, file + MESH_CACHE_EXTENSION:
+// this header, the vertices exactly as the Vert of the model lays them out, then the 32 bit indices.
+// The cache is used while the source keeps its size and modification time, or else still hashes the same.
+const char MESH_CACHE_EXTENSION[] = ".mesh";
+const uint32_t MESH_CACHE_VERSION = 1;
+
+struct MeshCacheHeader {
+	char magic[4];        // "BMSH"
+	uint32_t version;
+	uint32_t vertexSize;  // sizeof(Vert)
+	uint32_t layout;      // which components the vertex descriptor fills in, and where
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint64_t sourceSize;
+	int64_t sourceTime;   // in ticks of std::filesystem::file_time_type
+	uint64_t sourceHash;  // FNV-1a of the whole source file
+};
+
+// The GPU buffers of a mesh loaded from a file, shared by every Model that loads the same file
+// with the same vertex descriptor, and destroyed once the last of them is cleaned up. See BaseProject::sharedMeshes.
+typedef std::pair<std::string, VertexDescriptor *> MeshKey;
+
+struct SharedMesh {
+	VkBuffer vertexBuffer;
+	VkDeviceMemory vertexBufferMemory;
+	VkBuffer indexBuffer;
+	VkDeviceMemory indexBufferMemory;
+	std::vector<uint32_t> indices;
+	int users;
+};
+
 template <class Vert>
 class Model {
 	BaseProject *BP;
@@ -215,14 +303,22 @@ class Model {
 	VkBuffer indexBuffer;
 	VkDeviceMemory indexBufferMemory;
 	VertexDescriptor *VD;
+	bool sharesMesh = false;
+	MeshKey meshKey;
 
 	public:
 	std::vector<Vert> vertices{};
 	std::vector<uint32_t> indices{};
 	void loadModelOBJ(std::string file);
 	void loadModelGLTF(std::string file, bool encoded);
+	// a mesh loaded from the cache goes straight from the mapped file to the buffers, leaving vertices empty.
+	bool loadMeshCache(std::string file);
+	void writeMeshCache(std::string file);
+	uint32_t meshLayout();
 	void createIndexBuffer();
 	void createVertexBuffer();
+	void createBuffer(const void *source, VkDeviceSize bufferSize, VkBufferUsageFlags usage,
+					  VkBuffer &buffer, VkDeviceMemory &bufferMemory);
 
 	void init(BaseProject *bp, VertexDescriptor *VD, std::string file, ModelType MT);
 	void initMesh(BaseProject *bp, VertexDescriptor *VD);
@@ -240,7 +336,18 @@ struct Texture {
 	int imgs;
 	static const int maxImgs = 6;
 	
+	// the images of a texture as stbi_load() returns them, between the two halves of createTextureImage().
+	struct DecodedImages {
+		stbi_uc *pixels[maxImgs];
+		int width, height, channels;
+	};
+	
 	void createTextureImage(const char *const files[], VkFormat Fmt);
+	// decoding touches nothing but the files, so textures can be decoded on any thread.
+	void decodeImages(const char *const files[], DecodedImages &decoded);
+	// frees the pixels; the staging buffer has to stay until the commands of BP have run.
+	void uploadImages(const char *const files[], DecodedImages &decoded, VkFormat Fmt,
+					  VkBuffer &stagingBuffer, VkDeviceMemory &stagingBufferMemory);
 	void createTextureImageView(VkFormat Fmt);
 	void createTextureSampler(VkFilter magFilter,
 							 VkFilter minFilter,
@@ -257,6 +364,31 @@ struct Texture {
 	void cleanup();
 };
 
+// Loads many textures at once, like calling init() on each of them. The textures go in windows of about
+// TEXTURE_BATCH_MAX_STAGING bytes of pixels, sized from the headers of the files: the files of a window are decoded
+// in parallel, then their uploads are recorded into one command buffer and submitted together,
+// so that no more than a window of decoded images and of staging memory is held at once.
+const VkDeviceSize TEXTURE_BATCH_MAX_STAGING = 64 << 20;
+
+class TextureBatch {
+	struct Entry {
+		Texture *texture;
+		std::string file;
+		VkFormat Fmt;
+		bool initSampler;
+		Texture::DecodedImages decoded;
+		std::exception_ptr failure;
+	};
+	std::vector<Entry> entries;
+	
+	public:
+	void add(Texture &texture, const char *file, VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB, bool initSampler = true) {
+		entries.push_back({&texture, file, Fmt, initSampler, {}, nullptr});
+	}
+	// 0 threads uses one per hardware thread. Throws like Texture::init() if a file can't be loaded.
+	void load(BaseProject *bp, int numThreads = 0);
+};
+
 struct DescriptorSetLayoutBinding {
 	uint32_t binding;
 	VkDescriptorType type;
@@ -332,6 +464,7 @@ class BaseProject {
 	friend class VertexDescriptor;
 	template <class Vert> friend class Model;
 	friend class Texture;
+	friend class TextureBatch;
 	friend class Pipeline;
 	friend class DescriptorSetLayout;
 	friend class DescriptorSet;
@@ -392,6 +525,9 @@ protected:
 	std::vector<VkFramebuffer> swapChainFramebuffers;
 	size_t currentFrame = 0;
 	bool framebufferResized = false;
+	
+	// meshes loaded from files, by absolute path and vertex descriptor: see Model::init().
+	std::map<MeshKey, SharedMesh> sharedMeshes;
 
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderFinishedSemaphores;
@@ -1398,7 +1534,24 @@ std::cout << "Starting createInstance()\n"  << std::flush;
 		endSingleTimeCommands(commandBuffer);
 	}
 	
+	// while a batch is open, single time commands all go into its command buffer, submitted by endCommandBatch().
+	VkCommandBuffer commandBatch = VK_NULL_HANDLE;
+	
+	void beginCommandBatch() {
+		commandBatch = VK_NULL_HANDLE;
+		commandBatch = beginSingleTimeCommands();
+	}
+	
+	void endCommandBatch() {
+		VkCommandBuffer commandBuffer = commandBatch;
+		commandBatch = VK_NULL_HANDLE;
+		endSingleTimeCommands(commandBuffer);
+	}
+	
 	VkCommandBuffer beginSingleTimeCommands() { 
+		if(commandBatch != VK_NULL_HANDLE) {
+			return commandBatch;
+		}
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -1418,6 +1571,9 @@ std::cout << "Starting createInstance()\n"  << std::flush;
 	}
 	
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+		if(commandBuffer == commandBatch) {
+			return;
+		}
 		vkEndCommandBuffer(commandBuffer);
 		
 		VkSubmitInfo submitInfo{};
@@ -2011,6 +2167,23 @@ std::vector<VkVertexInputAttributeDescription> VertexDescriptor::getAttributeDes
 
 
 
+// an OBJ corner is a triple of indices into the position, normal and UV arrays, the same triple is the same vertex.
+struct OBJCornerHash {
+	size_t operator()(const tinyobj::index_t &i) const {
+		uint64_t h = (uint64_t)(uint32_t)i.vertex_index * 0x9E3779B97F4A7C15ull;
+		h ^= (uint64_t)(uint32_t)i.normal_index * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+		h ^= (uint64_t)(uint32_t)i.texcoord_index * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+		return (size_t)h;
+	}
+};
+
+struct OBJCornerEqual {
+	bool operator()(const tinyobj::index_t &a, const tinyobj::index_t &b) const {
+		return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index &&
+			   a.texcoord_index == b.texcoord_index;
+	}
+};
+
 template <class Vert>
 void Model<Vert>::loadModelOBJ(std::string file) {
 	tinyobj::attrib_t attrib;
@@ -2028,8 +2201,24 @@ void Model<Vert>::loadModelOBJ(std::string file) {
 //	std::cout << "Position " << VD->Position.hasIt << "," << VD->Position.offset << "\n";	
 //	std::cout << "UV " << VD->UV.hasIt << "," << VD->UV.offset << "\n";	
 //	std::cout << "Normal " << VD->Normal.hasIt << "," << VD->Normal.offset << "\n";	
+	// each corner shared by several faces becomes one vertex, referenced from the index buffer.
+	size_t numCorners = 0;
+	for (const auto& shape : shapes) {
+		numCorners += shape.mesh.indices.size();
+	}
+	indices.reserve(indices.size() + numCorners);
+	vertices.reserve(vertices.size() + attrib.vertices.size() / 3);
+	std::unordered_map<tinyobj::index_t, uint32_t, OBJCornerHash, OBJCornerEqual> uniqueVertices;
+	uniqueVertices.reserve(attrib.vertices.size() / 3);
+	
 	for (const auto& shape : shapes) {
 		for (const auto& index : shape.mesh.indices) {
+			auto found = uniqueVertices.find(index);
+			if(found != uniqueVertices.end()) {
+				indices.push_back(found->second);
+				continue;
+			}
+			
 			Vert vertex{};
 			glm::vec3 pos = {
 				attrib.vertices[3 * index.vertex_index + 0],
@@ -2070,8 +2259,9 @@ void Model<Vert>::loadModelOBJ(std::string file) {
 				*o = norm;
 			}
 			
+			uniqueVertices.emplace(index, (uint32_t)vertices.size());
+			indices.push_back(vertices.size());
 			vertices.push_back(vertex);
-			indices.push_back(vertices.size()-1);
 		}
 	}
 	std::cout << "[OBJ] Vertices: "<< vertices.size() << "\n";
@@ -2282,33 +2472,133 @@ void Model<Vert>::loadModelGLTF(std::string file, bool encoded) {
 }
 
 template <class Vert>
-void Model<Vert>::createVertexBuffer() {
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-	BP->createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
+void Model<Vert>::createBuffer(const void *source, VkDeviceSize bufferSize, VkBufferUsageFlags usage,
+							   VkBuffer &buffer, VkDeviceMemory &bufferMemory) {
+	BP->createBuffer(bufferSize, usage,
 						VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
 						VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-						vertexBuffer, vertexBufferMemory);
+						buffer, bufferMemory);
 
 	void* data;
-	vkMapMemory(BP->device, vertexBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vertices.data(), (size_t) bufferSize);
-	vkUnmapMemory(BP->device, vertexBufferMemory);			
+	vkMapMemory(BP->device, bufferMemory, 0, bufferSize, 0, &data);
+	memcpy(data, source, (size_t) bufferSize);
+	vkUnmapMemory(BP->device, bufferMemory);
+}
+
+template <class Vert>
+void Model<Vert>::createVertexBuffer() {
+	createBuffer(vertices.data(), sizeof(vertices[0]) * vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				 vertexBuffer, vertexBufferMemory);
 }
 
 template <class Vert>
 void Model<Vert>::createIndexBuffer() {
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+	createBuffer(indices.data(), sizeof(indices[0]) * indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+				 indexBuffer, indexBufferMemory);
+}
 
-	BP->createBuffer(bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-							 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-							 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-							 indexBuffer, indexBufferMemory);
+static uint64_t hashMeshSource(const uint8_t *data, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for(size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
 
-	void* data;
-	vkMapMemory(BP->device, indexBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), (size_t) bufferSize);
-	vkUnmapMemory(BP->device, indexBufferMemory);
+template <class Vert>
+uint32_t Model<Vert>::meshLayout() {
+	const VertexComponent *components[] = {&VD->Position, &VD->Normal, &VD->UV, &VD->Color, &VD->Tangent};
+	uint32_t layout = 2166136261u;
+	for(const VertexComponent *c : components) {
+		uint32_t value = c->hasIt ? c->offset + 1 : 0;
+		layout = (layout ^ value) * 16777619u;
+	}
+	return layout;
+}
+
+template <class Vert>
+bool Model<Vert>::loadMeshCache(std::string file) {
+	MappedFile cache;
+	if(!cache.open(file + MESH_CACHE_EXTENSION) || cache.size() < sizeof(MeshCacheHeader)) {
+		return false;
+	}
+	MeshCacheHeader header;
+	memcpy(&header, cache.data(), sizeof(header));
+	uint64_t vertexBytes = (uint64_t)header.vertexCount * sizeof(Vert);
+	uint64_t indexBytes = (uint64_t)header.indexCount * sizeof(uint32_t);
+	if(memcmp(header.magic, "BMSH", 4) != 0 || header.version != MESH_CACHE_VERSION ||
+	   header.vertexSize != sizeof(Vert) || header.layout != meshLayout() ||
+	   header.vertexCount == 0 || header.indexCount == 0 ||
+	   cache.size() != sizeof(header) + vertexBytes + indexBytes) {
+		return false;
+	}
+	
+	std::error_code error;
+	uint64_t sourceSize = std::filesystem::file_size(file, error);
+	if(error) return false;
+	int64_t sourceTime = std::filesystem::last_write_time(file, error).time_since_epoch().count();
+	if(error) return false;
+	if(sourceSize != header.sourceSize || sourceTime != header.sourceTime) {
+		// touched or checked out again, only a change of content makes the cache stale.
+		MappedFile source;
+		if(!source.open(file) || hashMeshSource(source.data(), source.size()) != header.sourceHash) {
+			return false;
+		}
+		// so that the next start doesn't hash it again.
+		header.sourceSize = sourceSize;
+		header.sourceTime = sourceTime;
+		std::fstream update(file + MESH_CACHE_EXTENSION, std::ios::in | std::ios::out | std::ios::binary);
+		update.write((const char *)&header, sizeof(header));
+	}
+	
+	std::cout << "Loading : " << file << "[cache]\n";
+	const uint8_t *vertexData = cache.data() + sizeof(header);
+	const uint8_t *indexData = vertexData + vertexBytes;
+	// the draw calls count the indices, so they are kept; the vertices are only needed by the GPU.
+	vertices.clear();
+	indices.resize(header.indexCount);
+	memcpy(indices.data(), indexData, indexBytes);
+	createBuffer(vertexData, vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer, vertexBufferMemory);
+	createBuffer(indexData, indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer, indexBufferMemory);
+	std::cout << "[cache] Vertices: " << header.vertexCount << "\n";
+	std::cout << "Indices: " << header.indexCount << "\n";
+	return true;
+}
+
+// best effort: a model directory that can't be written to just means parsing the OBJ every time.
+template <class Vert>
+void Model<Vert>::writeMeshCache(std::string file) {
+	MappedFile source;
+	std::error_code error;
+	if(vertices.empty() || indices.empty() || !source.open(file)) return;
+	
+	MeshCacheHeader header{};
+	memcpy(header.magic, "BMSH", 4);
+	header.version = MESH_CACHE_VERSION;
+	header.vertexSize = sizeof(Vert);
+	header.layout = meshLayout();
+	header.vertexCount = (uint32_t)vertices.size();
+	header.indexCount = (uint32_t)indices.size();
+	header.sourceSize = source.size();
+	header.sourceTime = std::filesystem::last_write_time(file, error).time_since_epoch().count();
+	header.sourceHash = hashMeshSource(source.data(), source.size());
+	if(error) return;
+	
+	// written aside and renamed, so that a crash never leaves half a cache behind.
+	std::string path = file + MESH_CACHE_EXTENSION;
+	std::string partial = path + ".tmp";
+	{
+		std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+		out.write((const char *)&header, sizeof(header));
+		out.write((const char *)vertices.data(), sizeof(Vert) * vertices.size());
+		out.write((const char *)indices.data(), sizeof(uint32_t) * indices.size());
+		if(!out) {
+			std::filesystem::remove(partial, error);
+			return;
+		}
+	}
+	std::filesystem::rename(partial, path, error);
 }
 
 template <class Vert>
@@ -2321,24 +2611,53 @@ void Model<Vert>::initMesh(BaseProject *bp, VertexDescriptor *vd) {
 	createIndexBuffer();
 }
 
+// a file already loaded with the same vertex descriptor is not loaded again, the model shares its buffers.
 template <class Vert>
 void Model<Vert>::init(BaseProject *bp, VertexDescriptor *vd, std::string file, ModelType MT) {
 	BP = bp;
 	VD = vd;
-	if(MT == OBJ) {
-		loadModelOBJ(file);
-	} else if(MT == GLTF) {
-		loadModelGLTF(file, false);
-	} else if(MT == MGCG) {
-		loadModelGLTF(file, true);
+	meshKey = MeshKey(std::filesystem::absolute(file).lexically_normal().string(), vd);
+	sharesMesh = true;
+	auto shared = BP->sharedMeshes.find(meshKey);
+	if(shared != BP->sharedMeshes.end()) {
+		SharedMesh &mesh = shared->second;
+		vertexBuffer = mesh.vertexBuffer;
+		vertexBufferMemory = mesh.vertexBufferMemory;
+		indexBuffer = mesh.indexBuffer;
+		indexBufferMemory = mesh.indexBufferMemory;
+		indices = mesh.indices;
+		mesh.users++;
+		std::cout << "Sharing : " << file << " (" << mesh.users << " models)\n";
+		return;
 	}
 	
-	createVertexBuffer();
-	createIndexBuffer();
+	if(MT == OBJ) {
+		if(!loadMeshCache(file)) {
+			loadModelOBJ(file);
+			writeMeshCache(file);
+			createVertexBuffer();
+			createIndexBuffer();
+		}
+	} else {
+		loadModelGLTF(file, MT == MGCG);
+		createVertexBuffer();
+		createIndexBuffer();
+	}
+	BP->sharedMeshes[meshKey] = {vertexBuffer, vertexBufferMemory, indexBuffer, indexBufferMemory, indices, 1};
 }
 
 template <class Vert>
 void Model<Vert>::cleanup() {
+	if(sharesMesh) {
+		sharesMesh = false;
+		auto shared = BP->sharedMeshes.find(meshKey);
+		if(shared != BP->sharedMeshes.end() && --shared->second.users > 0) {
+			return;
+		}
+		if(shared != BP->sharedMeshes.end()) {
+			BP->sharedMeshes.erase(shared);
+		}
+	}
    	vkDestroyBuffer(BP->device, indexBuffer, nullptr);
    	vkFreeMemory(BP->device, indexBufferMemory, nullptr);
 	vkDestroyBuffer(BP->device, vertexBuffer, nullptr);
@@ -2362,40 +2681,58 @@ void Model<Vert>::bind(VkCommandBuffer commandBuffer) {
 
 
 void Texture::createTextureImage(const char *const files[], VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB) {
+	DecodedImages decoded;
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	decodeImages(files, decoded);
+	uploadImages(files, decoded, Fmt, stagingBuffer, stagingBufferMemory);
+	vkDestroyBuffer(BP->device, stagingBuffer, nullptr);
+	vkFreeMemory(BP->device, stagingBufferMemory, nullptr);
+}
+
+void Texture::decodeImages(const char *const files[], DecodedImages &decoded) {
 	int texWidth, texHeight, texChannels;
-	int curWidth = -1, curHeight = -1, curChannels = -1;
-	stbi_uc* pixels[maxImgs];
 	
 	for(int i = 0; i < imgs; i++) {
-	 	pixels[i] = stbi_load(files[i], &texWidth, &texHeight,
+	 	decoded.pixels[i] = stbi_load(files[i], &texWidth, &texHeight,
 						&texChannels, STBI_rgb_alpha);
-		if (!pixels[i]) {
+		if (!decoded.pixels[i]) {
+			for(int j = 0; j < i; j++) {
+				stbi_image_free(decoded.pixels[j]);
+			}
 			std::cout << "Not found: " << files[i] << "\n";
 			throw std::runtime_error("failed to load texture image!");
 		}
-		std::cout << "[" << i << "]" << files[i] << " -> size: " << texWidth
-				  << "x" << texHeight << ", ch: " << texChannels <<"\n";
 				  
 		if(i == 0) {
-			curWidth = texWidth;
-			curHeight = texHeight;
-			curChannels = texChannels;
+			decoded.width = texWidth;
+			decoded.height = texHeight;
+			decoded.channels = texChannels;
 		} else {
-			if((curWidth != texWidth) ||
-			   (curHeight != texHeight) ||
-			   (curChannels != texChannels)) {
+			if((decoded.width != texWidth) ||
+			   (decoded.height != texHeight) ||
+			   (decoded.channels != texChannels)) {
+				for(int j = 0; j <= i; j++) {
+					stbi_image_free(decoded.pixels[j]);
+				}
 				throw std::runtime_error("multi texture images must be all of the same size!");
 			}
 		}
 	}
+}
+
+void Texture::uploadImages(const char *const files[], DecodedImages &decoded, VkFormat Fmt,
+						   VkBuffer &stagingBuffer, VkDeviceMemory &stagingBufferMemory) {
+	int texWidth = decoded.width, texHeight = decoded.height;
+	for(int i = 0; i < imgs; i++) {
+		std::cout << "[" << i << "]" << files[i] << " -> size: " << texWidth
+				  << "x" << texHeight << ", ch: " << decoded.channels <<"\n";
+	}
 	
 	VkDeviceSize imageSize = texWidth * texHeight * 4;
 	VkDeviceSize totalImageSize = texWidth * texHeight * 4 * imgs;
 	mipLevels = static_cast<uint32_t>(std::floor(
 					std::log2(std::max(texWidth, texHeight)))) + 1;
-	
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
 	 
 	BP->createBuffer(totalImageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 	  						VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
@@ -2404,8 +2741,8 @@ void Texture::createTextureImage(const char *const files[], VkFormat Fmt = VK_FO
 	void* data;
 	vkMapMemory(BP->device, stagingBufferMemory, 0, totalImageSize, 0, &data);
 	for(int i = 0; i < imgs; i++) {
-		memcpy(static_cast<char *>(data) + imageSize * i, pixels[i], static_cast<size_t>(imageSize));
-		stbi_image_free(pixels[i]);
+		memcpy(static_cast<char *>(data) + imageSize * i, decoded.pixels[i], static_cast<size_t>(imageSize));
+		stbi_image_free(decoded.pixels[i]);
 	}
 	vkUnmapMemory(BP->device, stagingBufferMemory);
 	
@@ -2424,9 +2761,6 @@ void Texture::createTextureImage(const char *const files[], VkFormat Fmt = VK_FO
 
 	BP->generateMipmaps(textureImage, Fmt,
 					texWidth, texHeight, mipLevels, imgs);
-
-	vkDestroyBuffer(BP->device, stagingBuffer, nullptr);
-	vkFreeMemory(BP->device, stagingBufferMemory, nullptr);
 }
 
 void Texture::createTextureImageView(VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB) {
@@ -2505,6 +2839,90 @@ void Texture::cleanup() {
 }
 
 
+void TextureBatch::load(BaseProject *bp, int numThreads) {
+	if(numThreads <= 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for(auto &entry : entries) {
+		entry.texture->BP = bp;
+		entry.texture->imgs = 1;
+	}
+	
+	size_t first = 0;
+	while(first < entries.size()) {
+		// a file stbi_info() can't read counts as empty, decoding it then fails like Texture::init() would.
+		size_t last = first;
+		VkDeviceSize windowSize = 0;
+		while(last < entries.size()) {
+			int width = 0, height = 0, channels = 0;
+			stbi_info(entries[last].file.c_str(), &width, &height, &channels);
+			VkDeviceSize size = (VkDeviceSize)width * height * 4;
+			if(last > first && windowSize + size > TEXTURE_BATCH_MAX_STAGING) {
+				break;
+			}
+			windowSize += size;
+			last++;
+		}
+		
+		std::atomic<size_t> next{first};
+		auto decode = [this, &next, last]() {
+			for(size_t i = next++; i < last; i = next++) {
+				const char *files[1] = {entries[i].file.c_str()};
+				try {
+					entries[i].texture->decodeImages(files, entries[i].decoded);
+				} catch(...) {
+					entries[i].failure = std::current_exception();
+				}
+			}
+		};
+		std::vector<std::thread> workers;
+		for(size_t t = 1; t < std::min((size_t)numThreads, last - first); t++) {
+			workers.emplace_back(decode);
+		}
+		decode();
+		for(auto &worker : workers) {
+			worker.join();
+		}
+		for(size_t i = first; i < last; i++) {
+			if(entries[i].failure) {
+				for(size_t j = first; j < last; j++) {
+					if(!entries[j].failure) {
+						stbi_image_free(entries[j].decoded.pixels[0]);
+					}
+				}
+				std::exception_ptr failure = entries[i].failure;
+				entries.clear();
+				std::rethrow_exception(failure);
+			}
+		}
+		
+		std::vector<std::pair<VkBuffer, VkDeviceMemory>> staging;
+		bp->beginCommandBatch();
+		for(size_t i = first; i < last; i++) {
+			const char *files[1] = {entries[i].file.c_str()};
+			VkBuffer stagingBuffer;
+			VkDeviceMemory stagingBufferMemory;
+			entries[i].texture->uploadImages(files, entries[i].decoded, entries[i].Fmt, stagingBuffer, stagingBufferMemory);
+			staging.push_back({stagingBuffer, stagingBufferMemory});
+		}
+		bp->endCommandBatch();
+		for(auto &buffer : staging) {
+			vkDestroyBuffer(bp->device, buffer.first, nullptr);
+			vkFreeMemory(bp->device, buffer.second, nullptr);
+		}
+		
+		for(size_t i = first; i < last; i++) {
+			entries[i].texture->createTextureImageView(entries[i].Fmt);
+			if(entries[i].initSampler) {
+				entries[i].texture->createTextureSampler();
+			}
+		}
+		first = last;
+	}
+	entries.clear();
+}
+
+
 
 
 
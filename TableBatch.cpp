@@ -0,0 +1,308 @@
+// first, so that its floating point rules also cover the inline code of the headers after it.
+#include "PortableMath.hpp"
+#include "TableBatch.hpp"
+#include "PhysicsKernels.hpp"
+#include <algorithm>
+#include <cstring>
+
+/*
+    Every step below mirrors GameLogic::stepPhysics with the stepped solver, in the same order and
+    with the same operations, so that each lane gives the bits a single table would.
+    Idle lanes have no ball awake, which masks them out of every kernel.
+ */
+
+TableBatch::TableBatch() : lanes(SIMD_WIDTH) {
+    std::memset(active, 0, sizeof(active));
+    std::memset(awake, 0, sizeof(awake));
+    std::fill(shotOf, shotOf + SIMD_WIDTH, -1);
+    std::fill(ticksOf, ticksOf + SIMD_WIDTH, 0);
+}
+
+void TableBatch::run(const GameLogic& table, const Shot* shots, int count, const StopConditions& stop,
+                     ShotOutcome* outcomes, int maxTicks) {
+    numBalls = table.numBalls;
+    std::copy(table.holes, table.holes + 6, holes);
+    float tick = 1.0f / table.physicsTickRate;
+
+    int next = 0;
+    auto refill = [&](int lane) {
+        shotOf[lane] = -1;
+        if (next < count) {
+            shotOf[lane] = next;
+            start(lane, table, shots[next++]);
+        }
+    };
+    // the end of GameLogic::simulateShot, once the lane is synced.
+    auto retire = [&](int lane, bool still) {
+        GameLogic& game = lanes[lane];
+        if (still && game.winner == -1)
+            game.finishShot();
+        outcomes[shotOf[lane]] = shotOutcome(game, shots[shotOf[lane]], ticksOf[lane]);
+        for (int i = 0; i < numBalls; i++)
+            awake[i][lane] = 0;
+        refill(lane);
+    };
+    for (int lane = 0; lane < SIMD_WIDTH; lane++)
+        refill(lane);
+
+    while (true) {
+        // shots that leave every ball at rest are over before the first tick.
+        for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+            while (shotOf[lane] != -1 && ticksOf[lane] == 0 && lanes[lane].awake.count == 0)
+                retire(lane, true);
+        }
+        unsigned running = 0;
+        for (int lane = 0; lane < SIMD_WIDTH; lane++)
+            running |= (shotOf[lane] != -1) << lane;
+        if (running == 0)
+            break;
+
+        step(tick);
+        if (stop.energyBelow > 0)
+            computeEnergy();
+
+        unsigned moving = 0;
+        for (int i = 0; i < numBalls; i++)
+            moving |= simd::bits(simd::loadMask(awake[i]));
+
+        for (; running != 0; running &= running - 1) {
+            int lane = __builtin_ctz(running);
+            GameLogic& game = lanes[lane];
+            ticksOf[lane]++;
+            bool still = !((moving >> lane) & 1);
+            bool cut = false;
+            if (!still) {
+                cut = game.stopsByRules(stop) || (stop.energyBelow > 0 && energy[lane] < stop.energyBelow);
+                if (!cut && stop.custom) {
+                    sync(lane);
+                    cut = stop.custom(game);
+                }
+            }
+            if (!still && !cut && ticksOf[lane] < maxTicks)
+                continue;
+            sync(lane);
+            if (cut) {
+                game.cutShotShort();
+                game.cutShort = true;
+                still = true;
+            }
+            retire(lane, still);
+        }
+    }
+}
+
+// strikes the shot on a fresh copy of the table and moves its balls into the lane.
+void TableBatch::start(int lane, const GameLogic& table, Shot shot) {
+    GameLogic& game = lanes[lane];
+    game = table;
+    game.recordEvents = true;
+    game.trackRotation = false;
+    game.cutShort = false;
+    game.strike(shot.direction, shot.charge);
+    ticksOf[lane] = 0;
+    for (int i = 0; i < numBalls; i++) {
+        x[i][lane] = game.physics.x[i];
+        y[i][lane] = game.physics.y[i];
+        vx[i][lane] = game.physics.vx[i];
+        vy[i][lane] = game.physics.vy[i];
+        radius[i][lane] = game.physics.radius[i];
+        active[i][lane] = game.physics.active[i];
+        awake[i][lane] = game.awake.contains(i) ? -1 : 0;
+    }
+}
+
+// copies the lane back into its GameLogic, before anything there looks at the motion of the balls.
+void TableBatch::sync(int lane) {
+    GameLogic& game = lanes[lane];
+    game.awake = ActiveSet();
+    for (int i = 0; i < numBalls; i++) {
+        game.physics.x[i] = x[i][lane];
+        game.physics.y[i] = y[i][lane];
+        game.physics.vx[i] = vx[i][lane];
+        game.physics.vy[i] = vy[i][lane];
+        game.physics.active[i] = active[i][lane];
+        if (awake[i][lane])
+            game.awake.wake(i);
+    }
+}
+
+void TableBatch::step(float deltaT) {
+    checkPockets();
+    checkCollisions();
+    moveBalls(deltaT);
+    animate(deltaT);
+    for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+        if (shotOf[lane] != -1)
+            lanes[lane].shotClock += deltaT;
+    }
+}
+
+// the lanes in which a ball of the given SIMD block is awake, GameLogic skips the other blocks.
+vmask TableBatch::awakeInBlock(int block) {
+    vmask result = simd::loadMask(awake[block]);
+    for (int i = block + 1; i < std::min(numBalls, block + SIMD_WIDTH); i++)
+        result = simd::maskOr(result, simd::loadMask(awake[i]));
+    return result;
+}
+
+void TableBatch::checkPockets() {
+    for (int block = 0; block < numBalls; block += SIMD_WIDTH) {
+        vmask blockAwake = awakeInBlock(block);
+        if (simd::bits(blockAwake) == 0)
+            continue;
+        for (int i = block; i < std::min(numBalls, block + SIMD_WIDTH); i++) {
+            vfloat ballX = simd::load(x[i]);
+            vfloat ballY = simd::load(y[i]);
+            vmask candidates = simd::maskAnd(blockAwake, simd::loadMask(active[i]));
+            unsigned inAnyHole = 0;
+            for (auto& hole : holes)
+                inAnyHole |= simd::bits(simd::maskAnd(candidates, withinKernel(ballX, ballY, simd::set1(hole.position.x), simd::set1(hole.position.y), simd::set1(hole.radius))));
+            for (; inAnyHole != 0; inAnyHole &= inAnyHole - 1) {
+                int lane = __builtin_ctz(inAnyHole);
+                glm::vec2 position(x[i][lane], y[i][lane]);
+                for (int h = 0; h < 6; h++) {
+                    if (glm::distance(position, holes[h].position) < holes[h].radius) {
+                        lanes[lane].handleScore(i, h);
+                        active[i][lane] = 0;
+                        awake[i][lane] = -1;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void TableBatch::checkCollisions() {
+    for (int block = 0; block < numBalls; block += SIMD_WIDTH) {
+        vmask blockAwake = awakeInBlock(block);
+        if (simd::bits(blockAwake) == 0)
+            continue;
+        for (int i = block; i < std::min(numBalls, block + SIMD_WIDTH); i++) {
+            vfloat ballX = simd::load(x[i]);
+            vfloat ballY = simd::load(y[i]);
+            vfloat ballVX = simd::load(vx[i]);
+            vfloat ballVY = simd::load(vy[i]);
+            cushionKernel(ballX, ballY, ballVX, ballVY, simd::load(radius[i]), simd::maskAnd(blockAwake, simd::loadMask(active[i])));
+            simd::store(x[i], ballX);
+            simd::store(y[i], ballY);
+            simd::store(vx[i], ballVX);
+            simd::store(vy[i], ballVY);
+        }
+    }
+
+    // pairs in the order of GameLogic::checkCollisionsBruteForce, each one tested with where its balls are by then.
+    for (int i = 0; i < numBalls - 1; i++) {
+        vmask activeI = simd::loadMask(active[i]);
+        if (simd::bits(activeI) == 0)
+            continue;
+        for (int j = i + 1; j < numBalls; j++) {
+            vmask candidates = simd::maskAnd(simd::maskAnd(activeI, simd::loadMask(active[j])),
+                                             simd::maskOr(simd::loadMask(awake[i]), simd::loadMask(awake[j])));
+            if (simd::bits(candidates) == 0)
+                continue;
+            vmask hit = simd::maskAnd(candidates, withinKernel(simd::load(x[i]), simd::load(y[i]), simd::load(x[j]), simd::load(y[j]),
+                                                               simd::add(simd::load(radius[i]), simd::load(radius[j]))));
+            if (simd::bits(hit) != 0)
+                collide(i, j, hit);
+        }
+    }
+}
+
+// GameLogic::handleBallCollision on the lanes in hit, operation for operation.
+void TableBatch::collide(int i, int j, vmask hit) {
+    using namespace simd;
+    vfloat xi = load(x[i]), yi = load(y[i]), xj = load(x[j]), yj = load(y[j]);
+    vfloat vxi = load(vx[i]), vyi = load(vy[i]), vxj = load(vx[j]), vyj = load(vy[j]);
+
+    vfloat dx = sub(xj, xi);
+    vfloat dy = sub(yj, yi);
+    vfloat lengthSquared = add(mul(dx, dx), mul(dy, dy));
+    vfloat correction = mul(sub(add(load(radius[i]), load(radius[j])), sqrt(lengthSquared)), set1(0.5f));
+    vfloat inverseLength = div(set1(1), sqrt(lengthSquared));
+    vfloat nx = mul(dx, inverseLength);
+    vfloat ny = mul(dy, inverseLength);
+    store(x[i], select(hit, sub(xi, mul(correction, nx)), xi));
+    store(y[i], select(hit, sub(yi, mul(correction, ny)), yi));
+    store(x[j], select(hit, add(xj, mul(correction, nx)), xj));
+    store(y[j], select(hit, add(yj, mul(correction, ny)), yj));
+
+    vfloat tx = neg(ny);
+    vfloat ty = nx;
+    vfloat normalJ = add(mul(nx, vxj), mul(ny, vyj));
+    vfloat normalI = add(mul(nx, vxi), mul(ny, vyi));
+    vfloat tangentI = add(mul(tx, vxi), mul(ty, vyi));
+    vfloat tangentJ = add(mul(tx, vxj), mul(ty, vyj));
+    store(vx[i], select(hit, add(mul(nx, normalJ), mul(tx, tangentI)), vxi));
+    store(vy[i], select(hit, add(mul(ny, normalJ), mul(ty, tangentI)), vyi));
+    store(vx[j], select(hit, add(mul(nx, normalI), mul(tx, tangentJ)), vxj));
+    store(vy[j], select(hit, add(mul(ny, normalI), mul(ty, tangentJ)), vyj));
+
+    storeMask(awake[i], maskOr(loadMask(awake[i]), hit));
+    storeMask(awake[j], maskOr(loadMask(awake[j]), hit));
+    for (unsigned lanesHit = bits(hit); lanesHit != 0; lanesHit &= lanesHit - 1)
+        lanes[__builtin_ctz(lanesHit)].handleContactRules(i, j);
+}
+
+void TableBatch::moveBalls(float deltaT) {
+    vfloat deltaV = simd::set1(FRICTION_FACTOR * deltaT);
+    vfloat step = simd::set1(deltaT);
+    vfloat zero = simd::set1(0);
+    for (int block = 0; block < numBalls; block += SIMD_WIDTH) {
+        vmask blockAwake = awakeInBlock(block);
+        if (simd::bits(blockAwake) == 0)
+            continue;
+        for (int i = block; i < std::min(numBalls, block + SIMD_WIDTH); i++) {
+            vfloat ballX = simd::load(x[i]);
+            vfloat ballY = simd::load(y[i]);
+            vfloat ballVX = simd::load(vx[i]);
+            vfloat ballVY = simd::load(vy[i]);
+            vmask ballActive = simd::loadMask(active[i]);
+            vmask moved = simd::maskAnd(blockAwake, ballActive);
+            frictionKernel(ballVX, ballVY, moved, deltaV);
+            displacementKernel(ballX, ballY, ballVX, ballVY, moved, step);
+            simd::store(x[i], ballX);
+            simd::store(y[i], ballY);
+            simd::store(vx[i], ballVX);
+            simd::store(vy[i], ballVY);
+
+            vmask moving = simd::maskOr(simd::neq(ballVX, zero), simd::neq(ballVY, zero));
+            simd::storeMask(awake[i], simd::maskAndNot(simd::loadMask(awake[i]), simd::maskAndNot(ballActive, moving)));
+        }
+    }
+}
+
+// falling balls are the awake ones no longer on the table, they go through GameLogic::applyAnimation.
+void TableBatch::animate(float deltaT) {
+    for (int i = 0; i < numBalls; i++) {
+        unsigned falling = simd::bits(simd::maskAndNot(simd::loadMask(awake[i]), simd::loadMask(active[i])));
+        for (; falling != 0; falling &= falling - 1) {
+            int lane = __builtin_ctz(falling);
+            GameLogic& game = lanes[lane];
+            if (!game.balls[i].animatingFall)
+                continue;
+            game.physics.x[i] = x[i][lane];
+            game.physics.y[i] = y[i][lane];
+            game.physics.vx[i] = vx[i][lane];
+            game.physics.vy[i] = vy[i][lane];
+            game.applyAnimation(i, deltaT);
+            x[i][lane] = game.physics.x[i];
+            y[i][lane] = game.physics.y[i];
+            if (!game.balls[i].animatingFall)
+                awake[i][lane] = 0;
+        }
+    }
+}
+
+// GameLogic::kineticEnergy for every lane, summed in the same ball order.
+void TableBatch::computeEnergy() {
+    vfloat sum = simd::set1(0);
+    for (int i = 0; i < numBalls; i++) {
+        vfloat ballVX = simd::load(vx[i]);
+        vfloat ballVY = simd::load(vy[i]);
+        vfloat ballEnergy = simd::div(simd::add(simd::mul(ballVX, ballVX), simd::mul(ballVY, ballVY)), simd::set1(2));
+        vmask counted = simd::maskAnd(simd::loadMask(awake[i]), simd::loadMask(active[i]));
+        sum = simd::select(counted, simd::add(sum, ballEnergy), sum);
+    }
+    simd::store(energy, sum);
+}
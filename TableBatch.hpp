@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GameLogic.hpp"
+#include "ShotEvaluator.hpp"
+#include "Simd.hpp"
+#include <vector>
+
+/*
+    Plays SIMD_WIDTH shots at once with the stepped solver, one table per SIMD lane.
+    A table of 16 balls leaves most of a vector idle when its balls share it, so here every vector
+    holds the same ball of SIMD_WIDTH different tables instead, and the friction, cushion, pocket and
+    collision math runs on all of them in lockstep. The rules stay scalar: each lane keeps its own
+    GameLogic, which is only called into for the rare pocket, contact and falling animation.
+    The outcomes are bit for bit those of evaluateShot() with the brute force broad phase,
+    and a lane whose shot is over is refilled with the next one right away.
+ */
+class TableBatch {
+public:
+    TableBatch();
+
+    // evaluates every shot on a copy of table, which has to use the stepped solver.
+    void run(const GameLogic& table, const Shot* shots, int count, const StopConditions& stop,
+             ShotOutcome* outcomes, int maxTicks = DEFAULT_PHYSICS_TICK_RATE * 600);
+
+private:
+    // ball-major: x[ball][lane] is where ball is on the table of that lane.
+    alignas(64) float x[MAX_BALLS][SIMD_WIDTH];
+    alignas(64) float y[MAX_BALLS][SIMD_WIDTH];
+    alignas(64) float vx[MAX_BALLS][SIMD_WIDTH];
+    alignas(64) float vy[MAX_BALLS][SIMD_WIDTH];
+    alignas(64) float radius[MAX_BALLS][SIMD_WIDTH];
+    alignas(64) int32_t active[MAX_BALLS][SIMD_WIDTH];
+    alignas(64) int32_t awake[MAX_BALLS][SIMD_WIDTH];
+    alignas(64) float energy[SIMD_WIDTH];
+
+    int numBalls = 0;
+    Hole holes[6];
+    std::vector<GameLogic> lanes;
+    int shotOf[SIMD_WIDTH];  // the index of the shot in each lane, -1 when the lane is idle.
+    int ticksOf[SIMD_WIDTH];
+
+    void start(int lane, const GameLogic& table, Shot shot);
+    void sync(int lane);
+    void step(float deltaT);
+    vmask awakeInBlock(int block);
+    void checkPockets();
+    void checkCollisions();
+    void collide(int i, int j, vmask hit);
+    void moveBalls(float deltaT);
+    void animate(float deltaT);
+    void computeEnergy();
+};
@@ -0,0 +1,75 @@
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+static const char MAGIC[4] = {'B', 'T', 'E', 'L'};
+static const int HEADER_SIZE = 8;
+
+Telemetry::Telemetry(const std::string& path, int capacity) {
+    this->capacity = 1;
+    while (this->capacity < (uint64_t)capacity)
+        this->capacity *= 2;
+    mask = this->capacity - 1;
+    ring = std::make_unique<TelemetryEvent[]>(this->capacity);
+
+    file.open(path, std::ios::binary);
+    if (!file)
+        return;
+    char header[HEADER_SIZE] = {MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3], TELEMETRY_VERSION, sizeof(TelemetryEvent), 0, 0};
+    file.write(header, HEADER_SIZE);
+    open = true;
+    writer = std::thread(&Telemetry::writerLoop, this);
+}
+
+Telemetry::~Telemetry() {
+    if (!writer.joinable())
+        return;
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+}
+
+void Telemetry::writerLoop() {
+    for (;;) {
+        // read before draining, so that nothing recorded before the destructor was called is left behind.
+        bool last = stopping.load(std::memory_order_acquire);
+        if (drain() == 0) {
+            if (last)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(TELEMETRY_FLUSH_INTERVAL_MS));
+        }
+    }
+    file.flush();
+}
+
+uint64_t Telemetry::drain() {
+    uint64_t from = tail.load(std::memory_order_relaxed);
+    uint64_t to = head.load(std::memory_order_acquire);
+    if (from == to)
+        return 0;
+    // straight out of the ring, in two pieces when it wraps around.
+    uint64_t start = from & mask;
+    uint64_t count = to - from;
+    uint64_t first = std::min(count, capacity - start);
+    file.write((const char*)(ring.get() + start), first * sizeof(TelemetryEvent));
+    file.write((const char*)ring.get(), (count - first) * sizeof(TelemetryEvent));
+    // flushed every batch, so that a session that crashes is still recorded up to there.
+    file.flush();
+    tail.store(to, std::memory_order_release);
+    return count;
+}
+
+bool Telemetry::read(const std::string& path, std::vector<TelemetryEvent>& events) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+    std::vector<char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (data.size() < HEADER_SIZE || memcmp(data.data(), MAGIC, 4) != 0 || data[4] != TELEMETRY_VERSION
+        || data[5] != sizeof(TelemetryEvent))
+        return false;
+    size_t count = (data.size() - HEADER_SIZE) / sizeof(TelemetryEvent);
+    events.resize(count);
+    memcpy(events.data(), data.data() + HEADER_SIZE, count * sizeof(TelemetryEvent));
+    return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int TELEMETRY_VERSION = 2; // 2 widened the balls to 16 bits for the large variant tables.
+const int TELEMETRY_RING_CAPACITY = 1 << 14; // events, rounded up to a power of two.
+const int TELEMETRY_FLUSH_INTERVAL_MS = 5;   // how long the writer sleeps once the ring is empty.
+
+// Something the simulation did, for analytics and for debugging the physics and the rules.
+// Unlike GameEvent it also covers the cushions, the strike and the turns, and it is written as is
+// to the telemetry file, so it holds no pointers and keeps its layout.
+struct TelemetryEvent
+{
+    enum Type : uint8_t {STRIKE, BALL_BALL, CUSHION, POCKET, FOUL, TURN, WINNER};
+    Type type;
+    int8_t player;  // the player whose shot it is, the next one for TURN.
+    int16_t ball;   // -1 for FOUL, TURN and WINNER.
+    int16_t other;  // the second ball for BALL_BALL, the hole for POCKET, 0 or 1 for a CUSHION along x or y,
+                    // the winning player for WINNER.
+    uint16_t reserved; // zero, so that no padding with whatever was in memory ends up in the file.
+    uint32_t shot;  // counted by the Telemetry from its first STRIKE.
+    float time;     // on the shot clock.
+    float x, y;     // where it happened on the table.
+    float value;    // the charge for STRIKE, the closing speed for BALL_BALL, the speed of the ball otherwise.
+    float direction; // of the STRIKE, in degrees.
+};
+static_assert(sizeof(TelemetryEvent) == 32, "the telemetry file is a raw dump of TelemetryEvent");
+
+/*
+    Streams TelemetryEvent from the simulation to a file without slowing it down.
+    record() only copies the event into a lock-free ring shared with a writer thread, which wakes up
+    every TELEMETRY_FLUSH_INTERVAL_MS and writes whatever it finds. The ring is single-producer:
+    all events have to come from one thread at a time, the one playing the game.
+    When the writer falls behind and the ring is full, events are dropped and counted rather than waited for.
+
+    The file is "BTEL", the version, the size of an event, two zero bytes, then the events as they are in memory.
+ */
+class Telemetry {
+public:
+    explicit Telemetry(const std::string& path, int capacity = TELEMETRY_RING_CAPACITY);
+    // drains the ring before returning.
+    ~Telemetry();
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+
+    // false if the file could not be created, record() then does nothing.
+    bool isOpen() {return open;}
+
+    // the hot path: never blocks, never allocates. A STRIKE starts the next shot.
+    void record(TelemetryEvent event) {
+        if (!open)
+            return;
+        if (event.type == TelemetryEvent::STRIKE)
+            shot++;
+        event.shot = shot;
+        uint64_t position = head.load(std::memory_order_relaxed);
+        if (position - cachedTail >= capacity) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position - cachedTail >= capacity) {
+                dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        ring[position & mask] = event;
+        head.store(position + 1, std::memory_order_release);
+    }
+    uint64_t getDropped() {return dropped.load(std::memory_order_relaxed);}
+
+    // every event of a telemetry file, false if it is missing or not one this version understands.
+    static bool read(const std::string& path, std::vector<TelemetryEvent>& events);
+
+private:
+    std::ofstream file;
+    bool open = false;
+    uint64_t capacity;
+    uint64_t mask;
+    std::unique_ptr<TelemetryEvent[]> ring;
+    uint32_t shot = 0;
+
+    // each on its own cache line, so that the producer and the writer don't keep stealing it from each other.
+    alignas(64) std::atomic<uint64_t> head{0};  // written by the producer.
+    uint64_t cachedTail = 0;                    // the producer's last look at tail.
+    alignas(64) std::atomic<uint64_t> tail{0};  // written by the writer.
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+
+    void writerLoop();
+    // writes out what is in the ring, returns how many events.
+    uint64_t drain();
+};
+
+// Which Telemetry a GameLogic reports to. A copy of a game reports nowhere: copies are the rollouts
+// of the AI and the previews, often on other threads, and their shots are never played for real.
+struct TelemetryLink
+{
+    Telemetry* target = nullptr;
+
+    TelemetryLink() = default;
+    TelemetryLink(const TelemetryLink&) {}
+    TelemetryLink& operator=(const TelemetryLink&) {return *this;}
+};
@@ -0,0 +1,70 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int numThreads) {
+    if (numThreads <= 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < numThreads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0)
+        return;
+    std::lock_guard<std::mutex> loopLock(loopMutex);
+    {
+        // a worker that woke up too late for the previous loop may still be on its way out of it.
+        std::unique_lock<std::mutex> lock(mutex);
+        loopDone.wait(lock, [&] {return busyWorkers == 0;});
+        this->task = &task;
+        this->count = count;
+        next = 0;
+        done = 0;
+        generation++;
+    }
+    wakeWorkers.notify_all();
+    runIterations();
+
+    // the task must outlive every worker still inside it, not only every iteration.
+    std::unique_lock<std::mutex> lock(mutex);
+    loopDone.wait(lock, [&] {return done == count && busyWorkers == 0;});
+    this->task = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+    int seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorkers.wait(lock, [&] {return stopping || generation != seenGeneration;});
+            if (stopping)
+                return;
+            seenGeneration = generation;
+            busyWorkers++;
+        }
+        runIterations();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busyWorkers--;
+        }
+        loopDone.notify_all();
+    }
+}
+
+void ThreadPool::runIterations() {
+    // iterations are handed out one at a time, each one is a whole shot or more.
+    for (int i = next++; i < count; i = next++) {
+        (*task)(i);
+        done++;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that split loops of independent iterations between them.
+// The calling thread works on the loop too, so a pool of size 1 has no extra thread at all.
+class ThreadPool {
+public:
+    // 0 uses one thread per hardware thread.
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // calls task(i) for every i in [0, count) and returns once all calls are done.
+    // Only one loop runs at a time, concurrent callers wait for their turn.
+    void parallelFor(int count, const std::function<void(int)>& task);
+    int size() {return (int)workers.size() + 1;}
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::mutex loopMutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable loopDone;
+
+    // the loop being run, guarded by mutex apart from the atomics.
+    const std::function<void(int)>* task = nullptr;
+    int count = 0;
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+    int generation = 0;
+    int busyWorkers = 0;
+    bool stopping = false;
+
+    void workerLoop();
+    void runIterations();
+};
@@ -0,0 +1,92 @@
+// Plays bot-vs-bot games of 8-ball on every core and sums up how each side did.
+//
+//     tournament [--games N] [--threads N] [--seed N] [--players POLICY POLICY] [--max-shots N] [--summary FILE]
+//                [--replays DIR]
+//
+// A POLICY is random, or greedyN to pick the best of N random shots (greedy alone is greedy32).
+// The summary is written to FILE as JSON, tournament.json by default.
+// With --replays every game is recorded to DIR/game-N.replay, which has to exist.
+
+#include "MatchRunner.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+struct Options {
+    int games = 1000;
+    int threads = 0;
+    uint64_t seed = 1;
+    std::string players[2] = {"greedy", "random"};
+    int maxShots = DEFAULT_MAX_SHOTS_PER_GAME;
+    std::string summary = "tournament.json";
+    std::string replays;
+};
+
+static void usage() {
+    std::cerr << "usage: tournament [--games N] [--threads N] [--seed N] [--players POLICY POLICY] [--max-shots N] [--summary FILE]\n"
+                 "                  [--replays DIR]\n";
+    exit(1);
+}
+
+static Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--games") == 0 && hasValue)
+            options.games = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+            options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--players") == 0 && i + 2 < argc) {
+            options.players[0] = argv[++i];
+            options.players[1] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--max-shots") == 0 && hasValue)
+            options.maxShots = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--summary") == 0 && hasValue)
+            options.summary = argv[++i];
+        else if (strcmp(argv[i], "--replays") == 0 && hasValue)
+            options.replays = argv[++i];
+        else
+            usage();
+    }
+    return options;
+}
+
+static std::unique_ptr<ShotPolicy> makePolicy(const std::string& name) {
+    if (name == "random")
+        return std::make_unique<RandomPolicy>();
+    if (name.rfind("greedy", 0) == 0) {
+        int candidates = name.size() > 6 ? atoi(name.c_str() + 6) : DEFAULT_GREEDY_CANDIDATES;
+        return std::make_unique<GreedyPolicy>(std::max(1, candidates));
+    }
+    std::cerr << "unknown policy " << name << "\n";
+    usage();
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    Options options = parseOptions(argc, argv);
+    auto first = makePolicy(options.players[0]);
+    auto second = makePolicy(options.players[1]);
+    MatchRunner runner(*first, *second, options.threads);
+    runner.maxShotsPerGame = options.maxShots;
+    runner.replayDirectory = options.replays;
+    TournamentSummary summary = runner.run(options.games, options.seed);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << summary.games << " games on " << summary.threads << " threads in " << summary.seconds << " s, "
+              << summary.games / summary.seconds << " games/s, "
+              << double(summary.shots) / summary.games << " shots per game, " << summary.unfinished << " unfinished\n";
+    for (int p = 0; p < 2; p++) {
+        std::cout << std::left << std::setw(12) << summary.players[p] << std::right
+                  << " wins " << std::setw(6) << 100.0 * summary.wins[p] / summary.games << "%"
+                  << "  fouls/game " << std::setw(6) << double(summary.fouls[p]) / summary.games
+                  << "  pocketed/game " << std::setw(6) << double(summary.pocketed[p]) / summary.games << "\n";
+    }
+    summary.write(options.summary);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+
+// the queue of the worker running on this thread, -1 outside of the pool.
+static thread_local int currentQueue = -1;
+static thread_local const WorkStealingPool* currentPool = nullptr;
+
+WorkStealingPool::WorkStealingPool(int numThreads) {
+    if (numThreads <= 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < numThreads; i++)
+        queues.push_back(std::make_unique<Queue>());
+    for (int i = 1; i < numThreads; i++)
+        workers.emplace_back(&WorkStealingPool::runTasks, this, i, false);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    idle.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    int queue = currentPool == this ? currentQueue : nextQueue++ % size();
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+        queues[queue]->tasks.push_back(std::move(task));
+        queued++;
+    }
+    // taking the lock orders this with a worker that just found every queue empty and is about to sleep.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    idle.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    runTasks(0, true);
+}
+
+bool WorkStealingPool::pop(int self, std::function<void()>& task) {
+    Queue& queue = *queues[self];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    queued--;
+    return true;
+}
+
+bool WorkStealingPool::steal(int self, std::function<void()>& task) {
+    for (int i = 1; i < size(); i++) {
+        Queue& queue = *queues[(self + i) % size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::runTasks(int self, bool untilDone) {
+    currentQueue = self;
+    currentPool = this;
+    std::function<void()> task;
+    while (true) {
+        if (pop(self, task) || steal(self, task)) {
+            task();
+            task = nullptr;
+            if (--pending == 0) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                }
+                idle.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [&] {return stopping || queued > 0 || (untilDone && pending == 0);});
+        if (stopping || (untilDone && pending == 0 && queued == 0))
+            break;
+    }
+    currentQueue = -1;
+    currentPool = nullptr;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads for tasks that spawn more tasks, such as a game that submits its own next shot.
+// Every worker has its own queue: it runs its newest task first, so a game stays on the thread whose
+// cache holds it, and a worker that runs dry steals the oldest task of another one.
+// The thread calling wait() works as worker 0, so a pool of size 1 has no extra thread at all.
+class WorkStealingPool {
+public:
+    // 0 uses one thread per hardware thread.
+    explicit WorkStealingPool(int numThreads = 0);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // from a task, the task goes to the queue of the worker running it, otherwise to the queues in turn.
+    void submit(std::function<void()> task);
+    // runs tasks until every task submitted so far, and every task they submitted, is done.
+    void wait();
+    int size() {return (int)queues.size();}
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> nextQueue{0};
+    std::atomic<int> queued{0};  // tasks waiting in a queue.
+    std::atomic<int> pending{0}; // tasks submitted and not finished yet.
+
+    // for idle workers to sleep on.
+    std::mutex mutex;
+    std::condition_variable idle;
+    bool stopping = false;
+
+    bool pop(int self, std::function<void()>& task);
+    bool steal(int self, std::function<void()>& task);
+    void runTasks(int self, bool untilDone);
+};
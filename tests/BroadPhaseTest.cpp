@@ -0,0 +1,102 @@
+// The uniform grid has to find exactly the touching pairs that testing every pair finds,
+// and a shot played with either broad phase has to come out the same.
+#include "GameLogic.hpp"
+#include <iostream>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+static bool touching(const BallPhysics& physics, int i, int j) {
+    float dx = physics.x[j] - physics.x[i];
+    float dy = physics.y[j] - physics.y[i];
+    float reach = physics.radius[i] + physics.radius[j];
+    return dx * dx + dy * dy < reach * reach;
+}
+
+static int checkPairs() {
+    int failures = 0;
+    std::mt19937 random(1);
+    auto physics = std::make_unique<BallPhysics>();
+    auto grid = std::make_unique<UniformGrid>();
+    int candidates[BALL_CAPACITY];
+    for (int layout = 0; layout < 2000; layout++) {
+        // from spread over the table to all in a corner, so that there are many contacts and crowded cells.
+        float spread = 1.0f + layout % 20;
+        float radius = layout % 2 ? 1.0f : 0.5f;
+        std::uniform_real_distribution<float> alongX(TABLE_BOTTOM_EDGE, std::min(TABLE_TOP_EDGE, TABLE_BOTTOM_EDGE + spread));
+        std::uniform_real_distribution<float> alongY(TABLE_LEFT_EDGE, std::min(TABLE_RIGHT_EDGE, TABLE_LEFT_EDGE + spread));
+        for (int i = 0; i < MAX_BALLS; i++) {
+            physics->x[i] = alongX(random);
+            physics->y[i] = alongY(random);
+            physics->radius[i] = radius;
+            physics->active[i] = random() % 8 ? -1 : 0;
+        }
+
+        std::vector<std::pair<int, int>> expected, found;
+        for (int i = 0; i < MAX_BALLS; i++) {
+            for (int j = i + 1; j < MAX_BALLS; j++) {
+                if (physics->active[i] && physics->active[j] && touching(*physics, i, j))
+                    expected.push_back({i, j});
+            }
+        }
+        grid->init(2 * radius);
+        grid->build(*physics, MAX_BALLS);
+        for (int i = 0; i < MAX_BALLS; i++) {
+            if (!physics->active[i])
+                continue;
+            int count = grid->candidates(*physics, i, candidates);
+            for (int k = 0; k < count; k++) {
+                if (k > 0 && candidates[k] <= candidates[k - 1])
+                    failures++;
+                if (touching(*physics, i, candidates[k]))
+                    found.push_back({i, candidates[k]});
+            }
+        }
+        if (found != expected) {
+            std::cerr << "layout " << layout << ": the grid found " << found.size() << " pairs, testing every pair "
+                      << expected.size() << std::endl;
+            failures++;
+        }
+    }
+    return failures;
+}
+
+static std::vector<GameEvent> play(GameLogic::BroadPhase broadPhase, float direction, float charge, uint64_t& checksum) {
+    GameLogic game;
+    game.init(MAX_BALLS);
+    game.broadPhase = broadPhase;
+    game.recordEvents = true;
+    game.strike(direction, charge);
+    game.simulateShot();
+    checksum = game.checksum();
+    return game.getEvents();
+}
+
+static int checkShots() {
+    int failures = 0;
+    for (int shot = 0; shot < 24; shot++) {
+        float direction = shot * 15.0f;
+        float charge = 0.5f + (shot % 4) * 0.7f;
+        uint64_t bruteForce, grid;
+        auto expected = play(GameLogic::BRUTE_FORCE, direction, charge, bruteForce);
+        auto found = play(GameLogic::UNIFORM_GRID, direction, charge, grid);
+        bool same = expected.size() == found.size() && bruteForce == grid;
+        for (size_t k = 0; same && k < expected.size(); k++) {
+            same = expected[k].type == found[k].type && expected[k].ball == found[k].ball
+                && expected[k].other == found[k].other && expected[k].time == found[k].time;
+        }
+        if (!same) {
+            std::cerr << "shot " << direction << " " << charge << " plays out differently on the grid" << std::endl;
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    int failures = checkPairs() + checkShots();
+    if (failures)
+        std::cerr << failures << " failures" << std::endl;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+// A replay written and read back has to give the same shots, and seeking to any shot, in any order,
+// has to set up the very table that shot was played from, on both solvers.
+#include "Replay.hpp"
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+const int KEYFRAME_INTERVAL = 4; // small, so that a short game spans several chunks.
+
+static int check(GameLogic::Solver solver, const std::string& path) {
+    GameLogic game;
+    game.init();
+    game.solver = solver;
+    game.deterministic = true;
+    ReplayWriter writer(KEYFRAME_INTERVAL);
+    writer.start(game);
+
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> anyDirection(0.0f, 360.0f);
+    std::uniform_real_distribution<float> anyCharge(0.3f, 2.5f);
+    std::vector<Shot> shots;
+    std::vector<uint64_t> tables; // the checksum of the table each shot is played from, then the last one.
+    while ((int)shots.size() < 30 && game.getWinner() == -1) {
+        Shot shot = {anyDirection(random), anyCharge(random)};
+        tables.push_back(game.checksum());
+        writer.recordShot(game, shot);
+        game.strike(shot.direction, shot.charge);
+        game.simulateShot();
+        shots.push_back(shot);
+    }
+    tables.push_back(game.checksum());
+    if (!writer.write(path)) {
+        std::cerr << "could not write " << path << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    ReplayReader reader;
+    if (!reader.open(path) || reader.getNumShots() != (int)shots.size()) {
+        std::cerr << "could not read the replay back" << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < (int)shots.size(); i++) {
+        Shot shot = reader.getShot(i);
+        if (shot.direction != shots[i].direction || shot.charge != shots[i].charge) {
+            std::cerr << "shot " << i << " reads back differently" << std::endl;
+            failures++;
+        }
+    }
+    // backwards then forwards, across chunks and within one.
+    std::vector<int> order;
+    for (int i = (int)shots.size(); i >= 0; i--)
+        order.push_back(i);
+    for (int i = 0; i <= (int)shots.size(); i++)
+        order.push_back(i);
+    for (int shot : order) {
+        GameLogic sought;
+        sought.init();
+        if (!reader.seek(sought, shot) || sought.checksum() != tables[shot]) {
+            std::cerr << "solver " << solver << ": seeking to shot " << shot << " gives another table" << std::endl;
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    std::string path = (std::filesystem::temp_directory_path() / "ReplayTest.replay").string();
+    int failures = check(GameLogic::STEPPED, path) + check(GameLogic::EVENT_DRIVEN, path);
+    std::filesystem::remove(path);
+    if (failures)
+        std::cerr << failures << " failures" << std::endl;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
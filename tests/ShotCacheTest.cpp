@@ -0,0 +1,62 @@
+// The shot cache must only ever hand back the outcome of the same shot on the same table, simulated the same way.
+#include "ShotCache.hpp"
+#include <iostream>
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << what << std::endl;
+        failures++;
+    }
+}
+
+int main() {
+    GameLogic table;
+    table.init();
+    StopConditions stop;
+    Shot shot = {30.0f, 1.5f};
+    ShotKey key = ShotCache::shotKey(ShotCache::tableKey(table, stop), shot);
+
+    // everything that changes how a shot plays out changes the key.
+    GameLogic other = table;
+    other.broadPhase = GameLogic::UNIFORM_GRID;
+    expect(!(ShotCache::shotKey(ShotCache::tableKey(other, stop), shot) == key), "the broad phase is not part of the key");
+    other = table;
+    other.deterministic = true;
+    expect(!(ShotCache::shotKey(ShotCache::tableKey(other, stop), shot) == key), "deterministic mode is not part of the key");
+    other = table;
+    other.solver = GameLogic::EVENT_DRIVEN;
+    expect(!(ShotCache::shotKey(ShotCache::tableKey(other, stop), shot) == key), "the solver is not part of the key");
+    expect(!(ShotCache::shotKey(ShotCache::tableKey(table, stop), {30.1f, 1.5f}) == key), "the direction is not part of the key");
+    // and what doesn't, doesn't.
+    expect(ShotCache::shotKey(ShotCache::tableKey(table, stop), {390.0f, 1.5f}) == key, "a full turn changes the key");
+
+    ShotCache cache(64);
+    ShotOutcome outcome, found;
+    outcome.ticks = 42;
+    expect(!cache.find(key, found), "an empty cache finds something");
+    cache.insert(key, outcome);
+    expect(cache.find(key, found) && found.ticks == 42, "an outcome inserted is not found");
+    // the first hash alone picks the entry, a different second one is another table that happens to collide.
+    expect(!cache.find({key.hash, key.check + 1}, found), "a collision of the first hash returns another table's outcome");
+    for (uint64_t i = 0; i < 1000; i++)
+        cache.insert({i, i}, outcome);
+    expect(cache.find({999, 999}, found), "the newest outcome was evicted");
+
+    // shots watched by a custom stop condition neither read nor fill the cache.
+    ShotEvaluator evaluator(1);
+    ShotCache shared;
+    evaluator.cache = &shared;
+    evaluator.stopConditions.custom = [](GameLogic&) {return false;};
+    evaluator.evaluate(table, {shot, shot});
+    expect(shared.hits() == 0 && shared.misses() == 0, "custom stop conditions go through the cache");
+    evaluator.stopConditions.custom = nullptr;
+    evaluator.evaluate(table, {shot});
+    evaluator.evaluate(table, {shot});
+    expect(shared.hits() == 1 && shared.misses() == 1, "without custom stop conditions the cache is not used");
+
+    if (failures)
+        std::cerr << failures << " failures" << std::endl;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
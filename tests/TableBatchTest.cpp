@@ -0,0 +1,59 @@
+// TableBatch has to give bit for bit the outcomes of evaluateShot() with the stepped solver,
+// whichever lane a shot lands in and however many shots share the batch.
+#include "AIPlayer.hpp"
+#include "TableBatch.hpp"
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+static bool same(const ShotOutcome& a, const ShotOutcome& b) {
+    return a.pocketed == b.pocketed && a.foul == b.foul && a.eightSunk == b.eightSunk && a.winner == b.winner
+        && a.nextPlayer == b.nextPlayer && a.ticks == b.ticks && a.cutShort == b.cutShort
+        && a.positions.size() == b.positions.size()
+        && memcmp(a.positions.data(), b.positions.data(), a.positions.size() * sizeof(glm::vec2)) == 0;
+}
+
+static int check(const GameLogic& table, const StopConditions& stop, const char* name) {
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> anyDirection(0.0f, 360.0f);
+    std::uniform_real_distribution<float> anyCharge(AI_MIN_CHARGE, AI_MAX_CHARGE);
+    // more shots than lanes and not a multiple of them, so that lanes are refilled and some end up idle.
+    std::vector<Shot> shots(4 * SIMD_WIDTH + 3);
+    for (auto& shot : shots)
+        shot = {anyDirection(random), anyCharge(random)};
+
+    std::vector<ShotOutcome> outcomes(shots.size());
+    auto batch = std::make_unique<TableBatch>();
+    batch->run(table, shots.data(), (int)shots.size(), stop, outcomes.data());
+    int failures = 0;
+    for (size_t i = 0; i < shots.size(); i++) {
+        if (!same(outcomes[i], evaluateShot(table, shots[i], stop))) {
+            std::cerr << name << ": shot " << shots[i].direction << " " << shots[i].charge
+                      << " differs from evaluateShot()" << std::endl;
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    GameLogic rack;
+    rack.init();
+    // a broken table, with balls scattered and some in the holes.
+    GameLogic broken = rack;
+    broken.strike(93.0f, 2.5f);
+    broken.simulateShot();
+    GameLogic deterministic = broken;
+    deterministic.deterministic = true;
+
+    int failures = 0;
+    for (const GameLogic* table : {&rack, &broken, &deterministic}) {
+        failures += check(*table, {}, "to rest");
+        failures += check(*table, rolloutStopConditions(), "rollout stop conditions");
+    }
+    if (failures)
+        std::cerr << failures << " failures" << std::endl;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+// Every task submitted to a WorkStealingPool, from outside or from another task, has to run exactly once,
+// however the workers steal from each other.
+#include "WorkStealingPool.hpp"
+#include <atomic>
+#include <iostream>
+#include <memory>
+
+const int TREES = 16;
+const int DEPTH = 10;
+const int TASKS_PER_TREE = (2 << DEPTH) - 1;
+
+// a binary tree of tasks, each submitting its two children, so that the queues fill up and drain unevenly.
+static void visit(WorkStealingPool& pool, std::atomic<int>* runs, int node, int depth) {
+    runs[node]++;
+    if (depth == DEPTH)
+        return;
+    pool.submit([&pool, runs, node, depth] {visit(pool, runs, 2 * node + 1, depth + 1);});
+    pool.submit([&pool, runs, node, depth] {visit(pool, runs, 2 * node + 2, depth + 1);});
+}
+
+int main() {
+    int failures = 0;
+    for (int threads : {1, 2, 4, 8}) {
+        WorkStealingPool pool(threads);
+        // the pool is used over and over, wait() has to leave it ready for the next round.
+        for (int round = 0; round < 5; round++) {
+            auto runs = std::make_unique<std::atomic<int>[]>(TREES * TASKS_PER_TREE);
+            for (int tree = 0; tree < TREES; tree++) {
+                std::atomic<int>* nodes = runs.get() + tree * TASKS_PER_TREE;
+                pool.submit([&pool, nodes] {visit(pool, nodes, 0, 0);});
+            }
+            pool.wait();
+            int wrong = 0;
+            for (int i = 0; i < TREES * TASKS_PER_TREE; i++)
+                wrong += runs[i] != 1;
+            if (wrong) {
+                std::cerr << threads << " threads, round " << round << ": " << wrong
+                          << " tasks did not run exactly once" << std::endl;
+                failures++;
+            }
+        }
+    }
+    if (failures)
+        std::cerr << failures << " failures" << std::endl;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}